@@ -4,6 +4,7 @@ import QtQuick.Controls 2.15
 import QtLocation 5.15
 import QtPositioning 5.15
 import QtQuick.Shapes 1.8
+import ProjetReseau 1.0
 
 Rectangle {
     width: 800
@@ -23,69 +24,23 @@ Rectangle {
         zoomLevel: 14
         center: QtPositioning.coordinate(initialCenterLat, initialCenterLon)
 
-        MapItemView {
-            id: vehicleView
-            model: simManager.vehiclesModel
-
-            delegate: MapQuickItem {
-                coordinate: QtPositioning.coordinate(modelData.lat, modelData.lon)
-                anchorPoint.x: communicationCircle.width / 2
-                anchorPoint.y: communicationCircle.height / 2
-
-                sourceItem: Item {
-                    id: container
-                    width: communicationCircle.width
-                    height: communicationCircle.height
-
-                    // Communication range circle
-                    Rectangle {
-                        id: communicationCircle
-                        anchors.centerIn: parent
-                        width: modelData.communicationRange / mapMetersPerPixel(map.zoomLevel) * 2
-                        height: width
-                        radius: width / 2
-                        visible: true
-                        opacity: 0.03
-                        gradient: RadialGradient {
-                            centerX: 0.5
-                            centerY: 0.5
-                            centerRadius: 0.5 // Radius relative to the rectangle size
-                            stops: [
-                                GradientStop { position: 0.0; color: modelData.color; },
-                                GradientStop { position: 1.0; color: "transparent"; }
-                            ]
-                        }
-                    }
-
-                    Image {
-                        id: carIcon
-                        anchors.centerIn: parent
-                        source: modelData.messageReceived ? "qrc:/images/car_green.svg" : "qrc:/images/car_icon.svg"
-                        width: 32
-                        height: 32
-                    }
-                }
-            }
-        }
-
-        MapItemView {
-            id: communicationLinksView
-            model: simManager.communicationLinksModel
+        // Only what is on screen is updated
+        onVisibleRegionChanged: simManager.setViewport(visibleRegion.boundingGeoRectangle())
 
-            delegate: MapPolyline {
-                line.color: "green"
-                line.width: 2
-                path: [
-                    QtPositioning.coordinate(startLat, startLon),
-                    QtPositioning.coordinate(endLat, endLon)
-                ]
-            }
+        // Every vehicle, its communication range and the live communication
+        // links, drawn in one batched layer; a density heatmap below heatmapZoom
+        VehicleLayer {
+            anchors.fill: parent
+            heatmapZoom: 13
+            simulation: simManager
+            center: map.center
+            zoomLevel: map.zoomLevel
         }
 
         // Render Blocked Edges as Red Lines using BlockedEdgesModel
         MapItemView {
             anchors.fill: parent
-            model: blockedEdgesModel
+            model: simManager.visibleBlockedEdges
 
             delegate: MapPolyline {
                 //line.color: flashing ? "green" : "red"
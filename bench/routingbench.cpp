@@ -0,0 +1,516 @@
+// routingbench.cpp
+// Microbenchmark for Graph::findPath on an imported OSM graph.
+//
+// Usage: projet-reseau-bench [queries] [seed]
+// Imports the same bounding box as the application, simplifies and freezes
+// the graph, then times the same random queries against the legacy
+// QMap-based A* ("before"), Graph::findPath's A* with the geodesic and the
+// ALT heuristic, and the contraction hierarchy query. Further scenarios
+// measure obstacle-driven replanning for a fleet of vehicles and the
+// throughput of RoutingService on a replan storm as worker threads are added.
+// The route cache is disabled for the search timings and measured on its own.
+// The last scenario compares V2V neighbour discovery by full scan and through
+// SpatialGrid, and checks that both reach the same vehicles.
+
+#include "graph.h"
+#include "dstarlite.h"
+#include "routingservice.h"
+#include "spatialgrid.h"
+#include "osmimporter.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+#include <QQueue>
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+namespace {
+
+// Copy of the original Graph::findPath: QMap scores initialised for every node
+// and a std::priority_queue that keeps stale entries.
+double legacyFindPathLength(const Graph &graph,
+                            const QMap<qint64, QList<Edge*>> &adjacencyList,
+                            qint64 startId, qint64 endId)
+{
+    auto compare = [](const QPair<qint64, double> &a, const QPair<qint64, double> &b) {
+        return a.second > b.second;
+    };
+    std::priority_queue<QPair<qint64, double>, std::vector<QPair<qint64, double>>, decltype(compare)> openSet(compare);
+
+    QMap<qint64, double> gScore;
+    QMap<qint64, double> fScore;
+    for (auto nodeId : graph.nodes.keys()) {
+        gScore[nodeId] = std::numeric_limits<double>::infinity();
+        fScore[nodeId] = std::numeric_limits<double>::infinity();
+    }
+
+    const QGeoCoordinate goal = graph.nodes[endId]->coordinate();
+    gScore[startId] = 0.0;
+    fScore[startId] = graph.nodes[startId]->coordinate().distanceTo(goal);
+    openSet.push({startId, fScore[startId]});
+
+    while (!openSet.empty()) {
+        qint64 currentId = openSet.top().first;
+        openSet.pop();
+        if (currentId == endId) {
+            return gScore[endId];
+        }
+        for (Edge *edge : adjacencyList[currentId]) {
+            qint64 neighborId = (edge->start->id == currentId) ? edge->end->id : edge->start->id;
+            double tentative = gScore[currentId] + edge->length;
+            if (tentative < gScore[neighborId]) {
+                gScore[neighborId] = tentative;
+                fScore[neighborId] = tentative + graph.nodes[neighborId]->coordinate().distanceTo(goal);
+                openSet.push({neighborId, fScore[neighborId]});
+            }
+        }
+    }
+    return -1.0;
+}
+
+double pathLength(const QList<Edge*> &path)
+{
+    double length = 0.0;
+    for (Edge *edge : path) {
+        length += edge->length;
+    }
+    return length;
+}
+
+// Obstacle storm: every vehicle hears about every obstacle, as after a V2V
+// broadcast. Compares rerouting every vehicle from scratch, rerouting only
+// vehicles whose route uses the edge, and repairing those with D* Lite.
+// Every D* Lite route is checked against findPath outside the timings;
+// returns false if any differs or is missing.
+bool benchmarkReplanning(Graph &graph, QRandomGenerator &rng)
+{
+    const int vehicleCount = 500;
+    const int obstacleCount = 25;
+
+    struct SimulatedVehicle {
+        qint64 position;
+        qint64 goal;
+        QList<Edge*> route;
+        EdgeSet knownBlockedEdges;
+    };
+
+    QList<SimulatedVehicle> vehicles;
+    for (int i = 0; i < vehicleCount; ++i) {
+        SimulatedVehicle vehicle;
+        vehicle.position = graph.nodeIdAt(rng.bounded(graph.nodeCount()));
+        vehicle.goal = graph.nodeIdAt(rng.bounded(graph.nodeCount()));
+        vehicle.route = graph.findPath(vehicle.position, vehicle.goal);
+        vehicles.append(vehicle);
+    }
+
+    // Half the obstacles land on someone's route, half anywhere
+    QList<quint32> obstacles;
+    while (obstacles.size() < obstacleCount) {
+        const SimulatedVehicle &vehicle = vehicles[rng.bounded(vehicleCount)];
+        Edge *edge = nullptr;
+        if (obstacles.size() % 2 == 0 && !vehicle.route.isEmpty()) {
+            edge = vehicle.route[rng.bounded(vehicle.route.size())];
+        } else {
+            edge = graph.csr().edge(rng.bounded(graph.csr().edgeCount()));
+        }
+        obstacles.append(edge->index);
+    }
+
+    auto routeHasEdge = [](const QList<Edge*> &route, quint32 edge) {
+        for (Edge *e : route) {
+            if (e->index == edge) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    QElapsedTimer timer;
+
+    // 1) Every vehicle reroutes from scratch on every obstacle
+    QList<SimulatedVehicle> state = vehicles;
+    timer.start();
+    for (quint32 obstacle : obstacles) {
+        for (SimulatedVehicle &vehicle : state) {
+            vehicle.knownBlockedEdges.insert(obstacle);
+            vehicle.route = graph.findPath(vehicle.position, vehicle.goal, vehicle.knownBlockedEdges);
+        }
+    }
+    const qint64 replanAllNs = timer.nsecsElapsed();
+
+    // 2) Only vehicles whose route uses the edge reroute from scratch
+    state = vehicles;
+    int affected = 0;
+    timer.restart();
+    for (quint32 obstacle : obstacles) {
+        for (SimulatedVehicle &vehicle : state) {
+            vehicle.knownBlockedEdges.insert(obstacle);
+            if (routeHasEdge(vehicle.route, obstacle)) {
+                affected++;
+                vehicle.route = graph.findPath(vehicle.position, vehicle.goal, vehicle.knownBlockedEdges);
+            }
+        }
+    }
+    const qint64 replanAffectedNs = timer.nsecsElapsed();
+
+    // A D* Lite route must have the length of a from-scratch search with
+    // the same avoid set; an empty route only when there is no route at all
+    int routeMismatches = 0;
+    int emptyRoutes = 0;
+    auto checkRoute = [&](const SimulatedVehicle &vehicle) {
+        const QList<Edge*> reference = graph.findPath(vehicle.position, vehicle.goal, vehicle.knownBlockedEdges);
+        if (vehicle.route.isEmpty() && vehicle.position != vehicle.goal) {
+            if (!reference.isEmpty()) {
+                emptyRoutes++;
+            }
+            return;
+        }
+        const double expected = pathLength(reference);
+        if (qAbs(pathLength(vehicle.route) - expected) > 1e-6 * qMax(1.0, expected)) {
+            routeMismatches++;
+        }
+    };
+
+    // 3) Same skip check, affected vehicles repair a long-lived D* Lite search
+    state = vehicles;
+    QList<DStarLite*> planners;
+    for (SimulatedVehicle &vehicle : state) {
+        DStarLite *planner = new DStarLite(graph, &vehicle.knownBlockedEdges);
+        planner->reset(graph.csr().indexOf(vehicle.goal));
+        planner->replan(graph.csr().indexOf(vehicle.position), vehicle.route);
+        planners.append(planner);
+        checkRoute(vehicle);
+    }
+    qint64 incrementalNs = 0;
+    QList<int> repaired;
+    for (quint32 obstacle : obstacles) {
+        repaired.clear();
+        timer.restart();
+        for (int i = 0; i < state.size(); ++i) {
+            SimulatedVehicle &vehicle = state[i];
+            vehicle.knownBlockedEdges.insert(obstacle);
+            planners[i]->notifyEdgeChanged(obstacle);
+            if (routeHasEdge(vehicle.route, obstacle)) {
+                planners[i]->replan(graph.csr().indexOf(vehicle.position), vehicle.route);
+                repaired.append(i);
+            }
+        }
+        incrementalNs += timer.nsecsElapsed();
+        for (int i : std::as_const(repaired)) {
+            checkRoute(state[i]);
+        }
+    }
+    qDeleteAll(planners);
+
+    qInfo().noquote() << QString("replanning: %1 vehicles, %2 obstacles, %3 affected reroutes")
+                             .arg(vehicleCount).arg(obstacleCount).arg(affected);
+    qInfo().noquote() << QString("  reroute everyone:        %1 ms").arg(replanAllNs / 1e6, 0, 'f', 1);
+    qInfo().noquote() << QString("  reroute affected only:   %1 ms (%2x)")
+                             .arg(replanAffectedNs / 1e6, 0, 'f', 1)
+                             .arg(double(replanAllNs) / qMax<qint64>(replanAffectedNs, 1), 0, 'f', 1);
+    qInfo().noquote() << QString("  D* Lite repair affected: %1 ms (%2x)")
+                             .arg(incrementalNs / 1e6, 0, 'f', 1)
+                             .arg(double(replanAllNs) / qMax<qint64>(incrementalNs, 1), 0, 'f', 1);
+    qInfo().noquote() << QString("  D* Lite routes checked:  %1 length mismatches, %2 missing routes")
+                             .arg(routeMismatches).arg(emptyRoutes);
+    if (routeMismatches > 0 || emptyRoutes > 0) {
+        qWarning() << "D* Lite routes differ from findPath.";
+        return false;
+    }
+    return true;
+}
+
+// Every vehicle asks for a new route at once, each with its own avoid set,
+// and the batch is timed from submission until the last future resolves.
+void benchmarkRoutingService(Graph &graph, QRandomGenerator &rng)
+{
+    const int requestCount = 5000;
+    const int avoidCount = 5;
+
+    const quint32 edgeCount = graph.csr().edgeCount();
+
+    QList<RouteRequest> requests;
+    for (int i = 0; i < requestCount; ++i) {
+        RouteRequest request;
+        request.startId = graph.nodeIdAt(rng.bounded(graph.nodeCount()));
+        request.goalId = graph.nodeIdAt(rng.bounded(graph.nodeCount()));
+        for (int j = 0; j < avoidCount && edgeCount > 0; ++j) {
+            request.avoidEdges.insert(rng.bounded(edgeCount));
+        }
+        requests.append(request);
+    }
+
+    qInfo().noquote() << QString("replan storm: %1 requests, %2 avoided edges each")
+                             .arg(requestCount).arg(avoidCount);
+
+    RoutingService service(graph);
+    double singleThreadRate = 0.0;
+    QElapsedTimer timer;
+    for (int threads = 1; threads <= QThread::idealThreadCount(); threads *= 2) {
+        service.setMaxThreadCount(threads);
+        timer.start();
+        QList<QFuture<QList<Edge*>>> futures = service.requestRoutes(requests);
+        service.waitForDone();
+        const qint64 elapsedNs = timer.nsecsElapsed();
+
+        int unreachable = 0;
+        for (const QFuture<QList<Edge*>> &future : futures) {
+            if (future.result().isEmpty()) {
+                unreachable++;
+            }
+        }
+        const double rate = requestCount / (qMax<qint64>(elapsedNs, 1) / 1e9);
+        if (threads == 1) {
+            singleThreadRate = rate;
+        }
+        qInfo().noquote() << QString("%1 %2 routes/s (%3x), %4 unreachable")
+                                 .arg(QString("%1 thread(s):").arg(threads).leftJustified(24))
+                                 .arg(rate, 0, 'f', 0)
+                                 .arg(rate / singleThreadRate, 0, 'f', 2)
+                                 .arg(unreachable);
+    }
+}
+
+// Repeats the same queries cold, warm, and after obstacle churn, with the
+// counters from RouteCache::stats() for each round.
+void benchmarkRouteCache(Graph &graph, const QList<QPair<qint64, qint64>> &queries, QRandomGenerator &rng)
+{
+    graph.setRouteCacheCapacity(RouteCache::DefaultCapacity);
+
+    QList<QPair<qint64, qint64>> edgeKeys;
+    for (auto it = graph.getEdges().constBegin(); it != graph.getEdges().constEnd(); ++it) {
+        if (it.key().first < it.key().second && !it.value()->blocked) {
+            edgeKeys.append(it.key());
+        }
+    }
+
+    QElapsedTimer timer;
+    RouteCache::Stats previous;
+    auto runRound = [&](const char *label) {
+        timer.start();
+        for (const auto &query : queries) {
+            graph.findPath(query.first, query.second);
+        }
+        const qint64 elapsedNs = timer.nsecsElapsed();
+        const RouteCache::Stats stats = graph.routeCacheStats();
+        qInfo().noquote() << QString("%1 %2 us/query, %3 hits, %4 misses, %5 invalidated, %6/%7 entries")
+                                 .arg(QString(label).leftJustified(24))
+                                 .arg(elapsedNs / 1000.0 / qMax(1, int(queries.size())), 0, 'f', 2)
+                                 .arg(stats.hits - previous.hits)
+                                 .arg(stats.misses - previous.misses)
+                                 .arg(stats.invalidations - previous.invalidations)
+                                 .arg(stats.size).arg(stats.capacity);
+        previous = stats;
+    };
+
+    runRound("route cache cold:");
+    runRound("route cache warm:");
+
+    QList<QPair<qint64, qint64>> churn;
+    for (int i = 0; i < 25 && !edgeKeys.isEmpty(); ++i) {
+        churn.append(edgeKeys.takeAt(rng.bounded(edgeKeys.size())));
+        graph.blockEdge(churn.last().first, churn.last().second);
+    }
+    runRound("after 25 blocks:");
+    for (const auto &edge : churn) {
+        graph.unblockEdge(edge.first, edge.second);
+    }
+    runRound("after 25 unblocks:");
+
+    graph.setRouteCacheCapacity(0);
+}
+
+// Flood from a sender across vehicles in range, as in
+// SimulationManager::findConnectedVehicles
+QList<int> floodByScan(const QVector<PlanePoint> &positions, const QVector<double> &ranges, int sender)
+{
+    QList<int> reached;
+    QVector<bool> visited(positions.size(), false);
+    QQueue<int> queue;
+    queue.enqueue(sender);
+    visited[sender] = true;
+    while (!queue.isEmpty()) {
+        const int current = queue.dequeue();
+        reached.append(current);
+        for (int other = 0; other < positions.size(); ++other) {
+            if (!visited[other] && planeDistance(positions[current], positions[other]) <= ranges[current]) {
+                visited[other] = true;
+                queue.enqueue(other);
+            }
+        }
+    }
+    return reached;
+}
+
+QList<int> floodByGrid(const QVector<PlanePoint> &positions, const QVector<double> &ranges, int sender)
+{
+    SpatialGrid grid;
+    grid.build(positions, *std::max_element(ranges.constBegin(), ranges.constEnd()));
+
+    QList<int> reached;
+    QVector<bool> visited(positions.size(), false);
+    QQueue<int> queue;
+    QVector<int> candidates;
+    queue.enqueue(sender);
+    visited[sender] = true;
+    while (!queue.isEmpty()) {
+        const int current = queue.dequeue();
+        reached.append(current);
+        candidates.clear();
+        grid.query(positions[current], ranges[current], candidates);
+        for (int other : candidates) {
+            if (!visited[other]) {
+                visited[other] = true;
+                queue.enqueue(other);
+            }
+        }
+    }
+    return reached;
+}
+
+// Vehicles scattered on graph nodes with the application's range spread
+bool benchmarkNeighbourDiscovery(const Graph &graph, QRandomGenerator &rng)
+{
+    const int reports = 20;
+    bool identical = true;
+    for (int vehicleCount : {500, 2000, 5000}) {
+        QVector<PlanePoint> positions;
+        QVector<double> ranges;
+        for (int i = 0; i < vehicleCount; ++i) {
+            positions.append(graph.position(graph.nodeIdAt(rng.bounded(graph.nodeCount()))));
+            ranges.append(100.0 + rng.bounded(770.0));
+        }
+
+        QElapsedTimer timer;
+        qint64 scanNs = 0;
+        qint64 gridNs = 0;
+        qint64 reachedTotal = 0;
+        for (int r = 0; r < reports; ++r) {
+            const int sender = rng.bounded(vehicleCount);
+            timer.start();
+            const QList<int> byScan = floodByScan(positions, ranges, sender);
+            scanNs += timer.nsecsElapsed();
+            timer.start();
+            const QList<int> byGrid = floodByGrid(positions, ranges, sender);
+            gridNs += timer.nsecsElapsed();
+            identical = identical && byScan == byGrid;
+            reachedTotal += byGrid.size();
+        }
+        qInfo().noquote() << QString("%1 scan %2 ms/report, grid %3 ms/report (%4x), %5 reached/report")
+                                 .arg(QString("%1 vehicles:").arg(vehicleCount).leftJustified(24))
+                                 .arg(scanNs / 1e6 / reports, 0, 'f', 2)
+                                 .arg(gridNs / 1e6 / reports, 0, 'f', 2)
+                                 .arg(double(scanNs) / qMax<qint64>(gridNs, 1), 0, 'f', 1)
+                                 .arg(double(reachedTotal) / reports, 0, 'f', 0);
+    }
+    if (!identical) {
+        qWarning() << "Spatial grid flood differs from the full scan.";
+    }
+    return identical;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const int queryCount = argc > 1 ? QString(argv[1]).toInt() : 500;
+    const quint32 seed = argc > 2 ? QString(argv[2]).toUInt() : 42;
+
+    Graph fullGraph;
+    OSMImporter importer(fullGraph);
+
+    QEventLoop loop;
+    QObject::connect(&importer, &OSMImporter::finished, &loop, &QEventLoop::quit);
+    importer.importData(QStringLiteral("47.74,7.32,47.76,7.34"));
+    QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    if (fullGraph.nodes.isEmpty()) {
+        qWarning() << "Import failed, nothing to benchmark.";
+        return 1;
+    }
+
+    Graph graph = fullGraph.createSimplifiedGraph();
+    graph.setRouteCacheCapacity(0);
+    graph.freeze();
+
+    // Rebuild the adjacency the legacy search walked
+    QMap<qint64, QList<Edge*>> adjacencyList;
+    for (auto it = graph.getEdges().constBegin(); it != graph.getEdges().constEnd(); ++it) {
+        if (it.key().first < it.key().second) {
+            adjacencyList[it.key().first].append(it.value());
+            adjacencyList[it.key().second].append(it.value());
+        }
+    }
+
+    QRandomGenerator rng(seed);
+    QList<QPair<qint64, qint64>> queries;
+    for (int i = 0; i < queryCount; ++i) {
+        queries.append(qMakePair(graph.nodeIdAt(rng.bounded(graph.nodeCount())),
+                                 graph.nodeIdAt(rng.bounded(graph.nodeCount()))));
+    }
+
+    QElapsedTimer timer;
+    QList<double> legacyLengths;
+    timer.start();
+    for (const auto &query : queries) {
+        legacyLengths.append(legacyFindPathLength(graph, adjacencyList, query.first, query.second));
+    }
+    const qint64 legacyNs = timer.nsecsElapsed();
+
+    int mismatches = 0;
+    auto runQueries = [&](const char *label) {
+        qint64 expanded = 0;
+        timer.restart();
+        for (int i = 0; i < queries.size(); ++i) {
+            SearchStats stats;
+            QList<Edge*> path = graph.findPath(queries[i].first, queries[i].second, {}, &stats);
+            expanded += stats.expandedNodes;
+            if (legacyLengths[i] >= 0.0 && qAbs(pathLength(path) - legacyLengths[i]) > 1e-6) {
+                mismatches++;
+            }
+        }
+        const qint64 elapsedNs = timer.nsecsElapsed();
+        qInfo().noquote() << QString("%1 %2 us/query (%3x), %4 expanded nodes/query")
+                                 .arg(QString(label).leftJustified(24))
+                                 .arg(elapsedNs / 1000.0 / queryCount, 0, 'f', 2)
+                                 .arg(double(legacyNs) / qMax<qint64>(elapsedNs, 1), 0, 'f', 1)
+                                 .arg(double(expanded) / queryCount, 0, 'f', 0);
+    };
+
+    qInfo().noquote() << QString("graph: %1 nodes, %2 edges, %3 queries")
+                             .arg(graph.nodeCount()).arg(graph.csr().edgeCount()).arg(queryCount);
+    qInfo().noquote() << QString("%1 %2 us/query")
+                             .arg(QString("before (QMap A*):").leftJustified(24))
+                             .arg(legacyNs / 1000.0 / queryCount, 0, 'f', 2);
+
+    runQueries("A* geodesic:");
+
+    timer.restart();
+    graph.buildLandmarks(16);
+    qInfo() << "landmarks built in" << timer.elapsed() << "ms";
+    runQueries("A* ALT (16 landmarks):");
+
+    timer.restart();
+    graph.buildContractionHierarchy();
+    qInfo() << "contraction hierarchy built in" << timer.elapsed() << "ms";
+    runQueries("contraction hierarchy:");
+
+    benchmarkRouteCache(graph, queries, rng);
+    const bool replansMatch = benchmarkReplanning(graph, rng);
+    benchmarkRoutingService(graph, rng);
+    const bool neighboursMatch = benchmarkNeighbourDiscovery(graph, rng);
+
+    if (mismatches > 0) {
+        qWarning() << mismatches << "queries returned a different path length.";
+        return 1;
+    }
+    return replansMatch && neighboursMatch ? 0 : 1;
+}
@@ -48,50 +48,46 @@ QHash<int, QByteArray> BlockedEdgesModel::roleNames() const {
     return roles;
 }
 
-void BlockedEdgesModel::updateBlockedEdges(const QList<QPair<qint64, qint64>> &blockedEdges, const QMap<QPair<qint64, qint64>, Edge*> &edges) {
+void BlockedEdgesModel::setRegistry(ObstacleRegistry *registry) {
+    if (m_registry)
+        disconnect(m_registry, nullptr, this, nullptr);
+
     beginResetModel();
+    m_registry = registry;
     m_blockedEdges.clear();
+    endResetModel();
 
-    for (const auto &pair : blockedEdges) {
-        Edge *edge = edges.value(pair, nullptr);
-        if (edge) {
-            BlockedEdge be;
-            be.startLat = edge->start->coordinate.latitude();
-            be.startLon = edge->start->coordinate.longitude();
-            be.endLat = edge->end->coordinate.latitude();
-            be.endLon = edge->end->coordinate.longitude();
-            be.blockedAt = QDateTime::currentDateTime(); // Set current time
-            be.startId = edge->start->id;
-            be.endId = edge->end->id;
-            m_blockedEdges.append(be);
-        }
+    if (m_registry) {
+        connect(m_registry, &ObstacleRegistry::edgeBlocked, this, &BlockedEdgesModel::addBlockedEdge);
+        connect(m_registry, &ObstacleRegistry::edgeUnblocked, this, &BlockedEdgesModel::removeBlockedEdge);
     }
-
-    endResetModel();
 }
 
-void BlockedEdgesModel::addBlockedEdgeWithTimestamp(qint64 startId, qint64 endId, double startLat, double startLon, double endLat, double endLon, const QDateTime &timestamp)
+void BlockedEdgesModel::addBlockedEdge(quint32 edge, double blockedAt)
 {
+    const CsrGraph &csrGraph = m_registry->getGraph().csr();
+    const quint32 start = csrGraph.edgeSource(edge);
+    const quint32 end = csrGraph.edgeTarget(edge);
+
     BlockedEdge be;
-    be.startId = startId;
-    be.endId = endId;
-    be.startLat = startLat;
-    be.startLon = startLon;
-    be.endLat = endLat;
-    be.endLon = endLon;
-    be.blockedAt = timestamp;
+    be.startId = csrGraph.osmId(start);
+    be.endId = csrGraph.osmId(end);
+    be.startLat = csrGraph.latitude(start);
+    be.startLon = csrGraph.longitude(start);
+    be.endLat = csrGraph.latitude(end);
+    be.endLon = csrGraph.longitude(end);
+    be.blockedAt = blockedAt;
+    be.edge = edge;
 
     beginInsertRows(QModelIndex(), m_blockedEdges.size(), m_blockedEdges.size());
     m_blockedEdges.append(be);
     endInsertRows();
 }
 
-void BlockedEdgesModel::removeBlockedEdge(qint64 startId, qint64 endId)
+void BlockedEdgesModel::removeBlockedEdge(quint32 edge)
 {
     for (int i = 0; i < m_blockedEdges.size(); ++i) {
-        const BlockedEdge &edge = m_blockedEdges.at(i);
-        if ((edge.startId == startId && edge.endId == endId) ||
-            (edge.startId == endId && edge.endId == startId)) {
+        if (m_blockedEdges.at(i).edge == edge) {
             beginRemoveRows(QModelIndex(), i, i);
             m_blockedEdges.removeAt(i);
             endRemoveRows();
@@ -110,7 +106,7 @@ QVariantList BlockedEdgesModel::getBlockedEdges() const {
         map["endLon"] = edge.endLon;
         map["startId"] = edge.startId;
         map["endId"] = edge.endId;
-        map["blockedAt"] = edge.blockedAt.toString(Qt::ISODate);
+        map["blockedAt"] = edge.blockedAt;
         list.append(map);
     }
     return list;
@@ -2,17 +2,18 @@
 #define BLOCKEDEDGESMODEL_H
 
 #include <QAbstractListModel>
-#include <QDateTime>
-#include "graph.h"
+#include <QPointer>
+#include "obstacleregistry.h"
 
 struct BlockedEdge {
     double startLat;
     double startLon;
     double endLat;
     double endLon;
-    QDateTime blockedAt; // Timestamp when the edge was blocked
-    qint64 startId;      // Node IDs for unblocking
+    double blockedAt;    // Simulated time (s) when the edge was blocked
+    qint64 startId;      // OSM node IDs of the ends
     qint64 endId;
+    quint32 edge;        // Dense edge id in the registry
 };
 
 class BlockedEdgesModel : public QAbstractListModel {
@@ -38,13 +39,19 @@ public:
     // Role names
     QHash<int, QByteArray> roleNames() const override;
 
-    // Methods to update the model
-    void updateBlockedEdges(const QList<QPair<qint64, qint64>> &blockedEdges, const QMap<QPair<qint64, qint64>, Edge*> &edges);
-    void addBlockedEdgeWithTimestamp(qint64 startId, qint64 endId, double startLat, double startLon, double endLat, double endLon, const QDateTime &timestamp);
-    void removeBlockedEdge(qint64 startId, qint64 endId);
+    /**
+     * @brief setRegistry
+     * Follows the edgeBlocked and edgeUnblocked events of registry; the rows
+     * only change through them. Edges blocked before the call are not listed.
+     */
+    void setRegistry(ObstacleRegistry *registry);
     QVariantList getBlockedEdges() const;
 
 private:
+    void addBlockedEdge(quint32 edge, double blockedAt);
+    void removeBlockedEdge(quint32 edge);
+
+    QPointer<ObstacleRegistry> m_registry;
     QList<BlockedEdge> m_blockedEdges;
 };
 
@@ -1,29 +1,29 @@
 #include "communicationlinksmodel.h"
 
-CommunicationLinksModel::CommunicationLinksModel(QObject *parent)
-    : QAbstractListModel(parent) {}
+CommunicationLinksModel::CommunicationLinksModel(QObject *parent, int capacity)
+    : QAbstractListModel(parent), ring(qMax(1, capacity)) {}
 
 int CommunicationLinksModel::rowCount(const QModelIndex &parent) const {
     if (parent.isValid())
         return 0;
-    return m_links.size();
+    return count;
 }
 
 QVariant CommunicationLinksModel::data(const QModelIndex &index, int role) const {
-    if (!index.isValid() || index.row() < 0 || index.row() >= m_links.size())
+    if (!index.isValid() || index.row() < 0 || index.row() >= count)
         return QVariant();
 
-    const CommunicationLink &link = m_links.at(index.row());
+    const CommunicationLink &row = link(index.row());
 
     switch (role) {
     case StartLatRole:
-        return link.start.latitude();
+        return row.startLat;
     case StartLonRole:
-        return link.start.longitude();
+        return row.startLon;
     case EndLatRole:
-        return link.end.latitude();
+        return row.endLat;
     case EndLonRole:
-        return link.end.longitude();
+        return row.endLon;
     default:
         return QVariant();
     }
@@ -38,8 +38,42 @@ QHash<int, QByteArray> CommunicationLinksModel::roleNames() const {
     return roles;
 }
 
-void CommunicationLinksModel::setCommunicationLinks(const QList<CommunicationLink> &links) {
-    beginResetModel();
-    m_links = links;
-    endResetModel();
+void CommunicationLinksModel::appendLinks(const QList<CommunicationLink> &links) {
+    const int capacity = ring.size();
+    // Only the newest capacity links can be kept
+    const int skipped = qMax(0, int(links.size()) - capacity);
+    const int incoming = int(links.size()) - skipped;
+    if (incoming == 0)
+        return;
+
+    dropFront(qMax(0, count + incoming - capacity));
+
+    beginInsertRows(QModelIndex(), count, count + incoming - 1);
+    for (int i = skipped; i < links.size(); ++i) {
+        ring[(head + count) % capacity] = links.at(i);
+        count++;
+    }
+    endInsertRows();
+}
+
+int CommunicationLinksModel::expire(double now) {
+    int expired = 0;
+    while (expired < count && link(expired).expiresAt <= now)
+        expired++;
+    dropFront(expired);
+    return expired;
+}
+
+void CommunicationLinksModel::clear() {
+    dropFront(count);
+    head = 0;
+}
+
+void CommunicationLinksModel::dropFront(int n) {
+    if (n <= 0)
+        return;
+    beginRemoveRows(QModelIndex(), 0, n - 1);
+    head = (head + n) % ring.size();
+    count -= n;
+    endRemoveRows();
 }
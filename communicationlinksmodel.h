@@ -2,13 +2,27 @@
 #define COMMUNICATIONLINKSMODEL_H
 
 #include <QAbstractListModel>
-#include <QGeoCoordinate>
+#include <QVector>
 
+// Ends of a link as shown on the map
 struct CommunicationLink {
-    QGeoCoordinate start;
-    QGeoCoordinate end;
+    double startLat;
+    double startLon;
+    double endLat;
+    double endLon;
+    double expiresAt;    // Simulated time (s) when the link leaves the map
 };
 
+/**
+ * @brief The CommunicationLinksModel class
+ * Links of the recent obstacle broadcasts, oldest first.
+ *
+ * The links live in a ring buffer of fixed capacity: new links are inserted
+ * as rows at the end and expired ones removed as rows from the front, so a
+ * broadcast never resets the model and memory stays bounded however many
+ * messages are sent. When the buffer is full the oldest links are dropped
+ * early to make room.
+ */
 class CommunicationLinksModel : public QAbstractListModel {
     Q_OBJECT
 
@@ -20,7 +34,9 @@ public:
         EndLonRole
     };
 
-    explicit CommunicationLinksModel(QObject *parent = nullptr);
+    static const int DefaultCapacity = 4096;
+
+    explicit CommunicationLinksModel(QObject *parent = nullptr, int capacity = DefaultCapacity);
 
     // Overrides
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
@@ -29,11 +45,32 @@ public:
     // Role names
     QHash<int, QByteArray> roleNames() const override;
 
-    // Update the model
-    void setCommunicationLinks(const QList<CommunicationLink> &links);
+    // Links currently shown, row 0 being the oldest
+    int size() const { return count; }
+    const CommunicationLink &link(int row) const { return ring[(head + row) % ring.size()]; }
+
+    /**
+     * @brief appendLinks
+     * Inserts the links of one broadcast after the existing rows. Links are
+     * expected in expiry order, which a single lifetime guarantees.
+     */
+    void appendLinks(const QList<CommunicationLink> &links);
+
+    /**
+     * @brief expire
+     * Removes the links whose expiresAt is not after now; returns how many.
+     */
+    int expire(double now);
+
+    void clear();
 
 private:
-    QList<CommunicationLink> m_links;
+    // Removes the n oldest rows
+    void dropFront(int n);
+
+    QVector<CommunicationLink> ring;
+    int head = 0;   // Slot of row 0
+    int count = 0;
 };
 
 #endif // COMMUNICATIONLINKSMODEL_H
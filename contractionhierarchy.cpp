@@ -0,0 +1,275 @@
+// contractionhierarchy.cpp
+#include "contractionhierarchy.h"
+#include "searchworkspace.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <limits>
+
+namespace {
+
+// Witness searches give up after settling this many nodes; a missed
+// witness only costs a redundant shortcut, never a wrong answer.
+const int WITNESS_SETTLE_LIMIT = 500;
+
+struct DynamicArc {
+    quint32 target;
+    double weight;
+    quint32 hierarchyEdge;
+};
+
+} // namespace
+
+void ContractionHierarchy::build(const CsrGraph &graph)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    nodeCount = graph.nodeCount();
+    shortcutTotal = 0;
+    hierarchyEdges.clear();
+
+    QVector<QVector<DynamicArc>> dynamicGraph(nodeCount);
+
+    auto addArc = [&dynamicGraph](quint32 from, const DynamicArc &arc) {
+        for (DynamicArc &existing : dynamicGraph[from]) {
+            if (existing.target == arc.target) {
+                if (arc.weight < existing.weight) {
+                    existing = arc;
+                }
+                return;
+            }
+        }
+        dynamicGraph[from].append(arc);
+    };
+
+    for (quint32 e = 0; e < graph.edgeCount(); ++e) {
+        const quint32 a = graph.edgeSource(e);
+        const quint32 b = graph.edgeTarget(e);
+        double weight = 0.0;
+        for (quint32 arc = graph.arcBegin(a); arc < graph.arcEnd(a); ++arc) {
+            if (graph.arcEdge(arc) == e) {
+                weight = graph.arcLength(arc);
+                break;
+            }
+        }
+        const quint32 id = quint32(hierarchyEdges.size());
+        hierarchyEdges.append({a, b, weight, e, CsrGraph::InvalidIndex,
+                               CsrGraph::InvalidIndex, CsrGraph::InvalidIndex});
+        addArc(a, {b, weight, id});
+        addArc(b, {a, weight, id});
+    }
+
+    SearchWorkspace witness;
+
+    // Runs the witness searches for contracting node; when shortcuts is
+    // non-null, the missing (u, w) pairs are appended as pairs of arc slots.
+    auto countShortcuts = [&](quint32 node, QVector<QPair<int, int>> *shortcuts) {
+        const QVector<DynamicArc> &arcs = dynamicGraph[node];
+        int needed = 0;
+        for (int i = 0; i < arcs.size(); ++i) {
+            double limit = 0.0;
+            for (int j = i + 1; j < arcs.size(); ++j) {
+                limit = qMax(limit, arcs[i].weight + arcs[j].weight);
+            }
+            if (i + 1 >= arcs.size()) {
+                break;
+            }
+
+            witness.prepare(nodeCount);
+            witness.reach(arcs[i].target, 0.0);
+            witness.heap.pushOrDecrease(arcs[i].target, 0.0);
+            int settled = 0;
+            while (!witness.heap.isEmpty() && settled < WITNESS_SETTLE_LIMIT) {
+                if (witness.heap.minKey() > limit) {
+                    break;
+                }
+                const quint32 current = witness.heap.popMin();
+                settled++;
+                const double currentDistance = witness.distance(current);
+                for (const DynamicArc &arc : dynamicGraph[current]) {
+                    if (arc.target == node) {
+                        continue;
+                    }
+                    const double distance = currentDistance + arc.weight;
+                    if (distance < witness.distance(arc.target)) {
+                        witness.reach(arc.target, distance);
+                        witness.heap.pushOrDecrease(arc.target, distance);
+                    }
+                }
+            }
+
+            for (int j = i + 1; j < arcs.size(); ++j) {
+                if (witness.distance(arcs[j].target) > arcs[i].weight + arcs[j].weight) {
+                    needed++;
+                    if (shortcuts) {
+                        shortcuts->append(qMakePair(i, j));
+                    }
+                }
+            }
+        }
+        return needed;
+    };
+
+    QVector<int> deletedNeighbors(nodeCount, 0);
+    auto priority = [&](quint32 node) {
+        return double(countShortcuts(node, nullptr) - dynamicGraph[node].size() + deletedNeighbors[node]);
+    };
+
+    IndexedHeap queue;
+    queue.reserve(nodeCount);
+    for (quint32 node = 0; node < nodeCount; ++node) {
+        queue.pushOrDecrease(node, priority(node));
+    }
+
+    QVector<QVector<DynamicArc>> upwardArcs(nodeCount);
+    while (!queue.isEmpty()) {
+        const quint32 node = queue.popMin();
+
+        // Lazy update: re-queue if the node is no longer the cheapest
+        const double current = priority(node);
+        if (!queue.isEmpty() && current > queue.minKey()) {
+            queue.pushOrDecrease(node, current);
+            continue;
+        }
+
+        QVector<QPair<int, int>> shortcuts;
+        countShortcuts(node, &shortcuts);
+
+        const QVector<DynamicArc> arcs = dynamicGraph[node];
+        for (const auto &pair : shortcuts) {
+            const DynamicArc &first = arcs[pair.first];
+            const DynamicArc &second = arcs[pair.second];
+            const quint32 id = quint32(hierarchyEdges.size());
+            const double weight = first.weight + second.weight;
+            hierarchyEdges.append({first.target, second.target, weight, CsrGraph::InvalidIndex,
+                                   node, first.hierarchyEdge, second.hierarchyEdge});
+            addArc(first.target, {second.target, weight, id});
+            addArc(second.target, {first.target, weight, id});
+            shortcutTotal++;
+        }
+
+        // Every remaining neighbour is contracted later, i.e. ranks higher
+        upwardArcs[node] = arcs;
+        for (const DynamicArc &arc : arcs) {
+            QVector<DynamicArc> &neighborArcs = dynamicGraph[arc.target];
+            for (int i = 0; i < neighborArcs.size(); ++i) {
+                if (neighborArcs[i].target == node) {
+                    neighborArcs.removeAt(i);
+                    break;
+                }
+            }
+            deletedNeighbors[arc.target]++;
+        }
+        dynamicGraph[node].clear();
+    }
+
+    upOffsets.resize(nodeCount + 1);
+    upOffsets[0] = 0;
+    for (quint32 node = 0; node < nodeCount; ++node) {
+        upOffsets[node + 1] = upOffsets[node] + quint32(upwardArcs[node].size());
+    }
+    upTargets.clear();
+    upWeights.clear();
+    upEdges.clear();
+    upTargets.reserve(upOffsets[nodeCount]);
+    upWeights.reserve(upOffsets[nodeCount]);
+    upEdges.reserve(upOffsets[nodeCount]);
+    for (quint32 node = 0; node < nodeCount; ++node) {
+        for (const DynamicArc &arc : upwardArcs[node]) {
+            upTargets.append(arc.target);
+            upWeights.append(arc.weight);
+            upEdges.append(arc.hierarchyEdge);
+        }
+    }
+
+    qDebug() << "Contraction hierarchy built in" << timer.elapsed() << "ms:"
+             << shortcutTotal << "shortcuts over" << graph.edgeCount() << "edges.";
+}
+
+bool ContractionHierarchy::query(quint32 source, quint32 target, QVector<quint32> &pathEdges) const
+{
+    pathEdges.clear();
+    if (source >= nodeCount || target >= nodeCount) {
+        return false;
+    }
+    if (source == target) {
+        return true;
+    }
+
+    SearchWorkspace &forward = SearchWorkspace::local(0);
+    SearchWorkspace &backward = SearchWorkspace::local(1);
+    forward.prepare(nodeCount);
+    backward.prepare(nodeCount);
+    forward.reach(source, 0.0);
+    forward.heap.pushOrDecrease(source, 0.0);
+    backward.reach(target, 0.0);
+    backward.heap.pushOrDecrease(target, 0.0);
+
+    double best = std::numeric_limits<double>::infinity();
+    quint32 meeting = CsrGraph::InvalidIndex;
+
+    while (!forward.heap.isEmpty() || !backward.heap.isEmpty()) {
+        const bool forwardTurn = backward.heap.isEmpty()
+                                 || (!forward.heap.isEmpty() && forward.heap.minKey() <= backward.heap.minKey());
+        SearchWorkspace &side = forwardTurn ? forward : backward;
+        const SearchWorkspace &other = forwardTurn ? backward : forward;
+
+        // Neither direction can improve on best past this key
+        if (side.heap.minKey() >= best) {
+            side.heap.clear();
+            continue;
+        }
+
+        const quint32 current = side.heap.popMin();
+        const double distance = side.distance(current);
+        if (other.isReached(current) && distance + other.distance(current) < best) {
+            best = distance + other.distance(current);
+            meeting = current;
+        }
+
+        for (quint32 arc = upOffsets[current]; arc < upOffsets[current + 1]; ++arc) {
+            const quint32 next = upTargets[arc];
+            const double nextDistance = distance + upWeights[arc];
+            if (nextDistance < side.distance(next)) {
+                side.reach(next, nextDistance, upEdges[arc], current);
+                side.heap.pushOrDecrease(next, nextDistance);
+            }
+        }
+    }
+
+    if (meeting == CsrGraph::InvalidIndex) {
+        return false;
+    }
+
+    // Source half: walk parents back from the meeting node, then unpack forwards
+    QVector<quint32> sourceHalf;
+    for (quint32 node = meeting; node != source; node = forward.parentNode(node)) {
+        sourceHalf.append(node);
+    }
+    for (int i = sourceHalf.size() - 1; i >= 0; --i) {
+        const quint32 node = sourceHalf[i];
+        unpack(forward.parentArc(node), forward.parentNode(node), pathEdges);
+    }
+
+    // Target half: parents already point towards the target
+    for (quint32 node = meeting; node != target; node = backward.parentNode(node)) {
+        unpack(backward.parentArc(node), node, pathEdges);
+    }
+    return true;
+}
+
+void ContractionHierarchy::unpack(quint32 hierarchyEdge, quint32 fromNode, QVector<quint32> &pathEdges) const
+{
+    const HierarchyEdge &edge = hierarchyEdges[hierarchyEdge];
+    if (edge.originalEdge != CsrGraph::InvalidIndex) {
+        pathEdges.append(edge.originalEdge);
+        return;
+    }
+    if (fromNode == edge.a) {
+        unpack(edge.childA, edge.a, pathEdges);
+        unpack(edge.childB, edge.middle, pathEdges);
+    } else {
+        unpack(edge.childB, edge.b, pathEdges);
+        unpack(edge.childA, edge.middle, pathEdges);
+    }
+}
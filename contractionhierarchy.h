@@ -0,0 +1,65 @@
+// contractionhierarchy.h
+#ifndef CONTRACTIONHIERARCHY_H
+#define CONTRACTIONHIERARCHY_H
+
+#include <QVector>
+#include "csrgraph.h"
+
+/**
+ * @brief The ContractionHierarchy class
+ * Contraction Hierarchies preprocessing and bidirectional query over a
+ * frozen CsrGraph.
+ *
+ * The hierarchy is built on unblocked edge lengths. Queries return the
+ * unpacked dense edge ids of the original graph; the caller decides what to
+ * do when one of them is currently blocked.
+ */
+class ContractionHierarchy {
+public:
+    ContractionHierarchy() = default;
+
+    /**
+     * @brief build
+     * Contracts every node of graph in edge-difference order and stores the
+     * resulting upward search graph.
+     */
+    void build(const CsrGraph &graph);
+
+    bool isEmpty() const { return nodeCount == 0; }
+    int shortcutCount() const { return shortcutTotal; }
+
+    /**
+     * @brief query
+     * Shortest path from source to target as original edge ids, in order.
+     * Returns false when target is unreachable.
+     */
+    bool query(quint32 source, quint32 target, QVector<quint32> &pathEdges) const;
+
+private:
+    // Original edge (originalEdge set) or shortcut a-middle-b (children set)
+    struct HierarchyEdge {
+        quint32 a;
+        quint32 b;
+        double weight;
+        quint32 originalEdge;
+        quint32 middle;
+        quint32 childA; // joins a and middle
+        quint32 childB; // joins middle and b
+    };
+
+    void unpack(quint32 hierarchyEdge, quint32 fromNode, QVector<quint32> &pathEdges) const;
+
+    quint32 nodeCount = 0;
+    int shortcutTotal = 0;
+    QVector<HierarchyEdge> hierarchyEdges;
+
+    // Upward graph: arcs from each node to its higher ranked neighbours
+    QVector<quint32> upOffsets;
+    QVector<quint32> upTargets;
+    QVector<double> upWeights;
+    QVector<quint32> upEdges;
+
+    friend class GraphSnapshot;
+};
+
+#endif // CONTRACTIONHIERARCHY_H
@@ -0,0 +1,67 @@
+// csrgraph.cpp
+#include "csrgraph.h"
+#include <algorithm>
+
+quint32 CsrGraph::indexOf(qint64 osmId) const
+{
+    auto it = std::lower_bound(osmIds.constBegin(), osmIds.constEnd(), osmId);
+    if (it == osmIds.constEnd() || *it != osmId) {
+        return InvalidIndex;
+    }
+    return quint32(it - osmIds.constBegin());
+}
+
+void CsrGraph::setBlocked(quint32 edge, bool blocked)
+{
+    if (blocked) {
+        blockedEdges.set(edge);
+    } else {
+        blockedEdges.reset(edge);
+    }
+}
+
+quint32 CsrGraph::findEdge(quint32 a, quint32 b) const
+{
+    if (a >= nodeCount() || b >= nodeCount()) {
+        return InvalidIndex;
+    }
+    // Rows are short on road networks, a linear scan beats any index here
+    for (quint32 arc = offsets[a]; arc < offsets[a + 1]; ++arc) {
+        if (arcTargets[arc] == b) {
+            return arcEdges[arc];
+        }
+    }
+    return InvalidIndex;
+}
+
+void CsrGraph::buildProjection()
+{
+    xs.clear();
+    ys.clear();
+    if (osmIds.isEmpty()) {
+        localProjection = LocalProjection();
+        planeBoundScale = 1.0;
+        return;
+    }
+
+    const auto latitudeRange = std::minmax_element(latitudes.constBegin(), latitudes.constEnd());
+    const auto longitudeRange = std::minmax_element(longitudes.constBegin(), longitudes.constEnd());
+    const double originLatitude = (*latitudeRange.first + *latitudeRange.second) / 2.0;
+    localProjection = LocalProjection(originLatitude,
+                                      (*longitudeRange.first + *longitudeRange.second) / 2.0);
+
+    // cos(latitude) is smallest on the edge of the box farthest from the
+    // equator; a box reaching a pole gets no usable bound from the plane
+    const double originCosine = std::cos(qDegreesToRadians(originLatitude));
+    const double edgeCosine = qMin(std::cos(qDegreesToRadians(*latitudeRange.first)),
+                                   std::cos(qDegreesToRadians(*latitudeRange.second)));
+    planeBoundScale = originCosine > 0.0 ? qBound(0.0, edgeCosine / originCosine, 1.0) : 0.0;
+
+    xs.reserve(latitudes.size());
+    ys.reserve(latitudes.size());
+    for (qsizetype i = 0; i < latitudes.size(); ++i) {
+        const PlanePoint point = localProjection.project(latitudes[i], longitudes[i]);
+        xs.append(point.x);
+        ys.append(point.y);
+    }
+}
@@ -0,0 +1,110 @@
+// csrgraph.h
+#ifndef CSRGRAPH_H
+#define CSRGRAPH_H
+
+#include <QVector>
+#include <QGeoCoordinate>
+#include "edge.h"
+#include "edgeset.h"
+#include "localprojection.h"
+
+/**
+ * @brief The CsrGraph class
+ * Frozen, contiguous view of a Graph in compressed-sparse-row form.
+ *
+ * OSM ids are remapped to dense quint32 indices (in ascending OSM id order,
+ * so indexOf() is a binary search). Each undirected edge appears as two arcs,
+ * one in the row of each endpoint. Arc data (targets, lengths, owning edge)
+ * and per-edge data (endpoints, a blocked bit) live in flat arrays; coordinates are
+ * kept apart as a latitude/longitude structure of arrays, along with their
+ * projection on the plane tangent at the centre of the graph.
+ */
+class CsrGraph {
+public:
+    static constexpr quint32 InvalidIndex = 0xFFFFFFFFu;
+
+    CsrGraph() = default;
+
+    bool isEmpty() const { return osmIds.isEmpty(); }
+    quint32 nodeCount() const { return quint32(osmIds.size()); }
+    quint32 edgeCount() const { return quint32(edgeSources.size()); }
+    quint32 arcCount() const { return quint32(arcTargets.size()); }
+
+    /**
+     * @brief indexOf
+     * Dense index of an OSM node id, or InvalidIndex if it is not in the graph.
+     */
+    quint32 indexOf(qint64 osmId) const;
+    qint64 osmId(quint32 node) const { return osmIds[node]; }
+
+    double latitude(quint32 node) const { return latitudes[node]; }
+    double longitude(quint32 node) const { return longitudes[node]; }
+    QGeoCoordinate coordinate(quint32 node) const {
+        return QGeoCoordinate(latitudes[node], longitudes[node]);
+    }
+    PlanePoint position(quint32 node) const { return {xs[node], ys[node]}; }
+    const LocalProjection &projection() const { return localProjection; }
+
+    /**
+     * @brief boundScale
+     * Factor that turns a plane distance between two nodes into a lower
+     * bound of their distance on the sphere. The plane stretches east-west
+     * distances by cos(origin)/cos(latitude) poleward of the origin; this is
+     * the smallest inverse of that stretch over the bounding box.
+     */
+    double boundScale() const { return planeBoundScale; }
+
+    // Arcs leaving node are [arcBegin(node), arcEnd(node))
+    quint32 arcBegin(quint32 node) const { return offsets[node]; }
+    quint32 arcEnd(quint32 node) const { return offsets[node + 1]; }
+    quint32 arcTarget(quint32 arc) const { return arcTargets[arc]; }
+    double arcLength(quint32 arc) const { return arcLengths[arc]; }
+    quint32 arcEdge(quint32 arc) const { return arcEdges[arc]; }
+
+    quint32 edgeSource(quint32 edge) const { return edgeSources[edge]; }
+    quint32 edgeTarget(quint32 edge) const { return edgeTargets[edge]; }
+    bool isBlocked(quint32 edge) const { return blockedEdges.test(edge); }
+    void setBlocked(quint32 edge, bool blocked);
+    const EdgeBitset &blocked() const { return blockedEdges; }
+
+    /**
+     * @brief findEdge
+     * Undirected edge joining two dense node indices, or InvalidIndex.
+     */
+    quint32 findEdge(quint32 a, quint32 b) const;
+
+    /**
+     * @brief edge
+     * Building-layer Edge object behind a dense edge index, so routing
+     * results can still be handed to Path.
+     */
+    Edge *edge(quint32 edge) const { return edgePointers[edge]; }
+
+private:
+    friend class Graph;
+    friend class GraphSnapshot;
+
+    // Centres the projection on the bounding box, fills xs/ys and sets
+    // planeBoundScale
+    void buildProjection();
+
+    QVector<qint64> osmIds;       // sorted, indexed by dense node index
+    QVector<double> latitudes;
+    QVector<double> longitudes;
+    QVector<double> xs;           // Projected coordinates, in meters
+    QVector<double> ys;
+    LocalProjection localProjection;
+    double planeBoundScale = 1.0;
+
+    QVector<quint32> offsets;     // nodeCount() + 1 entries
+    QVector<quint32> arcTargets;
+    QVector<double> arcLengths;
+    QVector<quint32> arcEdges;
+
+    QVector<quint32> edgeSources;
+    QVector<quint32> edgeTargets;
+    QVector<Edge*> edgePointers;
+    EdgeBitset blockedEdges;
+};
+
+#endif // CSRGRAPH_H
@@ -0,0 +1,184 @@
+// dstarlite.cpp
+#include "dstarlite.h"
+#include <limits>
+
+namespace {
+const double INF = std::numeric_limits<double>::infinity();
+}
+
+DStarLite::DStarLite(const Graph &graph, const EdgeSet *avoidEdges)
+    : graph(graph), avoidEdges(avoidEdges)
+{
+}
+
+void DStarLite::clear()
+{
+    goalNode = CsrGraph::InvalidIndex;
+    startNode = CsrGraph::InvalidIndex;
+    lastStart = CsrGraph::InvalidIndex;
+    km = 0.0;
+    gValues.clear();
+    rhsValues.clear();
+    open.clear();
+    openKeys.clear();
+}
+
+void DStarLite::reset(quint32 goal)
+{
+    clear();
+    goalNode = goal;
+    rhsValues.insert(goal, 0.0);
+    // The goal is queued by the first replan(), once the start is known
+}
+
+double DStarLite::g(quint32 node) const
+{
+    return gValues.value(node, INF);
+}
+
+double DStarLite::rhs(quint32 node) const
+{
+    return rhsValues.value(node, INF);
+}
+
+double DStarLite::arcCost(quint32 arc) const
+{
+    const CsrGraph &csr = graph.csr();
+    const quint32 edge = csr.arcEdge(arc);
+    if (csr.isBlocked(edge) || (avoidEdges && avoidEdges->contains(edge))) {
+        return INF;
+    }
+    return csr.arcLength(arc);
+}
+
+DStarLite::Key DStarLite::calculateKey(quint32 node) const
+{
+    const double best = qMin(g(node), rhs(node));
+    return Key(best + graph.estimate(startNode, node) + km, best);
+}
+
+void DStarLite::updateVertex(quint32 node)
+{
+    const CsrGraph &csr = graph.csr();
+    if (node != goalNode) {
+        double best = INF;
+        for (quint32 arc = csr.arcBegin(node); arc < csr.arcEnd(node); ++arc) {
+            best = qMin(best, arcCost(arc) + g(csr.arcTarget(arc)));
+        }
+        if (best == INF) {
+            rhsValues.remove(node);
+        } else {
+            rhsValues.insert(node, best);
+        }
+    }
+
+    auto queued = openKeys.constFind(node);
+    if (queued != openKeys.constEnd()) {
+        open.erase({queued.value(), node});
+        openKeys.erase(queued);
+    }
+    if (g(node) != rhs(node)) {
+        const Key key = calculateKey(node);
+        open.insert({key, node});
+        openKeys.insert(node, key);
+    }
+}
+
+void DStarLite::computeShortestPath()
+{
+    const CsrGraph &csr = graph.csr();
+    while (!open.empty()
+           && (open.begin()->first < calculateKey(startNode) || rhs(startNode) > g(startNode))) {
+        const Key oldKey = open.begin()->first;
+        const quint32 node = open.begin()->second;
+        const Key newKey = calculateKey(node);
+        open.erase(open.begin());
+        openKeys.remove(node);
+        expanded++;
+
+        if (oldKey < newKey) {
+            open.insert({newKey, node});
+            openKeys.insert(node, newKey);
+        } else if (g(node) > rhs(node)) {
+            gValues.insert(node, rhs(node));
+            for (quint32 arc = csr.arcBegin(node); arc < csr.arcEnd(node); ++arc) {
+                updateVertex(csr.arcTarget(arc));
+            }
+        } else {
+            gValues.remove(node);
+            updateVertex(node);
+            for (quint32 arc = csr.arcBegin(node); arc < csr.arcEnd(node); ++arc) {
+                updateVertex(csr.arcTarget(arc));
+            }
+        }
+    }
+}
+
+void DStarLite::notifyEdgeChanged(quint32 edge)
+{
+    if (!isActive() || startNode == CsrGraph::InvalidIndex || edge == CsrGraph::InvalidIndex) {
+        return;
+    }
+    const CsrGraph &csr = graph.csr();
+    updateVertex(csr.edgeSource(edge));
+    updateVertex(csr.edgeTarget(edge));
+}
+
+bool DStarLite::replan(quint32 start, QList<Edge*> &path)
+{
+    path.clear();
+    if (!isActive()) {
+        return false;
+    }
+
+    const CsrGraph &csr = graph.csr();
+    expanded = 0;
+    if (start == goalNode) {
+        return true;
+    }
+    if (startNode == CsrGraph::InvalidIndex) {
+        // First plan: key the goal against the real start
+        startNode = start;
+        lastStart = start;
+        const Key key = calculateKey(goalNode);
+        open.insert({key, goalNode});
+        openKeys.insert(goalNode, key);
+    } else if (start != startNode) {
+        startNode = start;
+        km += graph.estimate(lastStart, startNode);
+        lastStart = startNode;
+    }
+
+    // The search stops once the start is locally consistent or its key is
+    // reached, which may leave the start queued with g still infinite: its
+    // rhs, the best c(s, s') + g(s') over its neighbours, is the route length
+    computeShortestPath();
+    if (rhs(startNode) == INF) {
+        return false;
+    }
+
+    // Walk downhill on c(s, s') + g(s') from the start to the goal
+    quint32 current = startNode;
+    for (quint32 steps = 0; current != goalNode; ++steps) {
+        if (steps > csr.nodeCount()) {
+            path.clear();
+            return false;
+        }
+        quint32 bestArc = CsrGraph::InvalidIndex;
+        double best = INF;
+        for (quint32 arc = csr.arcBegin(current); arc < csr.arcEnd(current); ++arc) {
+            const double candidate = arcCost(arc) + g(csr.arcTarget(arc));
+            if (candidate < best) {
+                best = candidate;
+                bestArc = arc;
+            }
+        }
+        if (bestArc == CsrGraph::InvalidIndex) {
+            path.clear();
+            return false;
+        }
+        path.append(csr.edge(csr.arcEdge(bestArc)));
+        current = csr.arcTarget(bestArc);
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+// dstarlite.h
+#ifndef DSTARLITE_H
+#define DSTARLITE_H
+
+#include <QHash>
+#include <QList>
+#include <set>
+#include <utility>
+#include "graph.h"
+
+/**
+ * @brief The DStarLite class
+ * Incremental planner (D* Lite) towards a fixed goal.
+ *
+ * The search runs backwards from the goal, so the start can move along the
+ * route and edge cost changes only repair the vertices they affect instead of
+ * rerunning a full search. Edge costs are the open length, or infinity for
+ * edges blocked in the graph or listed in avoidEdges; every change to either
+ * must be reported through notifyEdgeChanged().
+ */
+class DStarLite {
+public:
+    explicit DStarLite(const Graph &graph, const EdgeSet *avoidEdges = nullptr);
+
+    /**
+     * @brief reset
+     * Forgets all search state and plans towards goal (a dense node index).
+     */
+    void reset(quint32 goal);
+    void clear();
+    bool isActive() const { return goalNode != CsrGraph::InvalidIndex; }
+    quint32 goal() const { return goalNode; }
+
+    void notifyEdgeChanged(quint32 edge);
+
+    /**
+     * @brief replan
+     * Repairs the search for the given start and writes the route into path.
+     * Returns false if the goal is unreachable.
+     */
+    bool replan(quint32 start, QList<Edge*> &path);
+
+    int expandedNodes() const { return expanded; }
+
+private:
+    using Key = std::pair<double, double>;
+
+    double g(quint32 node) const;
+    double rhs(quint32 node) const;
+    double arcCost(quint32 arc) const;
+    Key calculateKey(quint32 node) const;
+    void updateVertex(quint32 node);
+    void computeShortestPath();
+
+    const Graph &graph;
+    const EdgeSet *avoidEdges;
+
+    quint32 goalNode = CsrGraph::InvalidIndex;
+    quint32 startNode = CsrGraph::InvalidIndex;
+    quint32 lastStart = CsrGraph::InvalidIndex;
+    double km = 0.0;
+    int expanded = 0;
+
+    QHash<quint32, double> gValues;
+    QHash<quint32, double> rhsValues;
+    std::set<std::pair<Key, quint32>> open;
+    QHash<quint32, Key> openKeys;
+};
+
+#endif // DSTARLITE_H
@@ -3,6 +3,8 @@
 
 #include "node.h"
 
+class ShapeArena;
+
 class Edge {
 public:
     Node *start;
@@ -10,9 +12,21 @@ public:
     double length;
     bool blocked;
 
+    // Road points strictly between start and end, encoded in a ShapeArena;
+    // none for a straight edge
+    const ShapeArena *shapeArena = nullptr;
+    quint32 shapeOffset = 0;
+    quint32 shapeSize = 0;
+
+    // Dense undirected id in the CSR view, shared by both directions;
+    // only meaningful while the graph is frozen
+    quint32 index = 0xFFFFFFFFu;
+
     Edge(Node *start, Node *end, double length, bool blocked = false)
         : start(start), end(end), length(length), blocked(blocked) {}
 
+    bool hasShape() const { return shapeSize > 0; }
+
     void toggleBlock(bool status) {
         blocked = status;
     }
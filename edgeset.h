@@ -0,0 +1,92 @@
+// edgeset.h
+#ifndef EDGESET_H
+#define EDGESET_H
+
+#include <QVector>
+#include <QtAlgorithms>
+#include <algorithm>
+
+/**
+ * @brief The EdgeBitset class
+ * One bit per dense edge id of a frozen graph. Holds the global blocked
+ * state, so routing tests an edge with a shift and a mask; snapshots share
+ * the words until the graph blocks or unblocks something.
+ */
+class EdgeBitset {
+public:
+    EdgeBitset() = default;
+
+    // Clears every bit and sizes the set for edgeCount edges
+    void resize(quint32 edgeCount) {
+        words.fill(0, qsizetype((edgeCount + 63) / 64));
+    }
+
+    bool test(quint32 edge) const { return (words[edge >> 6] >> (edge & 63)) & 1; }
+    void set(quint32 edge) { words[edge >> 6] |= quint64(1) << (edge & 63); }
+    void reset(quint32 edge) { words[edge >> 6] &= ~(quint64(1) << (edge & 63)); }
+
+    int count() const {
+        int total = 0;
+        for (quint64 word : words) {
+            total += qPopulationCount(word);
+        }
+        return total;
+    }
+
+    // Calls f(edge) for every set bit, in ascending edge order
+    template <typename F>
+    void forEach(F f) const {
+        for (qsizetype w = 0; w < words.size(); ++w) {
+            for (quint64 word = words[w]; word; word &= word - 1) {
+                f(quint32(w * 64 + qCountTrailingZeroBits(word)));
+            }
+        }
+    }
+
+private:
+    QVector<quint64> words;
+};
+
+/**
+ * @brief The EdgeSet class
+ * Small sorted set of dense edge ids. A vehicle only learns about a handful
+ * of obstacles, so its avoid set costs four bytes per edge instead of a
+ * bitset over the whole graph.
+ */
+class EdgeSet {
+public:
+    using const_iterator = QVector<quint32>::const_iterator;
+
+    bool isEmpty() const { return ids.isEmpty(); }
+    int size() const { return int(ids.size()); }
+    const_iterator begin() const { return ids.constBegin(); }
+    const_iterator end() const { return ids.constEnd(); }
+
+    bool contains(quint32 edge) const {
+        return std::binary_search(ids.constBegin(), ids.constEnd(), edge);
+    }
+
+    // Returns false if edge was already in the set
+    bool insert(quint32 edge) {
+        auto it = std::lower_bound(ids.begin(), ids.end(), edge);
+        if (it != ids.end() && *it == edge) {
+            return false;
+        }
+        ids.insert(it, edge);
+        return true;
+    }
+
+    void remove(quint32 edge) {
+        auto it = std::lower_bound(ids.begin(), ids.end(), edge);
+        if (it != ids.end() && *it == edge) {
+            ids.erase(it);
+        }
+    }
+
+    void clear() { ids.clear(); }
+
+private:
+    QVector<quint32> ids;
+};
+
+#endif // EDGESET_H
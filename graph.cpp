@@ -2,27 +2,26 @@
 #include "graph.h"
 #include <cmath>
 #include <limits>
-#include <queue>
+#include <iterator>
 #include <QDebug>
+#include <QHash>
 #include <QSet>
 #include <QQueue>
 #include <QRandomGenerator>
 
-// Define qHash for QPair<qint64, qint64> to allow using QPair in QSet
-uint qHash(const QPair<qint64, qint64>& key, uint seed)
+Graph::Graph()
+    : shapes(new ShapeArena)
 {
-    return qHash(key.first, seed) ^ qHash(key.second, seed);
 }
 
-Graph::Graph() {}
-
-void Graph::addNode(qint64 id, const QGeoCoordinate &coordinate) {
+void Graph::addNode(qint64 id, double latitude, double longitude) {
     if (!nodes.contains(id)) {
-        nodes[id] = new Node(id, coordinate);
+        nodes[id] = new Node(id, latitude, longitude);
+        frozen = false;
     }
 }
 
-void Graph::addEdge(qint64 startId, qint64 endId, double length) {
+void Graph::addEdge(qint64 startId, qint64 endId, double length, const QVector<ShapePoint> &shape) {
     if (startId == endId) {
         return; // Prevent adding self-referential edges
     }
@@ -31,25 +30,165 @@ void Graph::addEdge(qint64 startId, qint64 endId, double length) {
         Node *startNode = nodes[startId];
         Node *endNode   = nodes[endId];
         Edge *edge      = new Edge(startNode, endNode, length);
+        if (!shape.isEmpty()) {
+            edge->shapeArena  = shapes.data();
+            edge->shapeOffset = shapes->append(startNode->latitude, startNode->longitude, shape);
+            edge->shapeSize   = quint32(shape.size());
+        }
         edges[qMakePair(startId, endId)] = edge;
         edges[qMakePair(endId, startId)] = edge;  // Bidirectional
         adjacencyList[startId].append(edge);
         adjacencyList[endId].append(edge);
+        frozen = false;
     }
 }
 
+void Graph::freeze() {
+    routing = RoutingSnapshot();
+    CsrGraph &csrGraph = routing.csrGraph;
+
+    // QMap iterates in ascending id order, which is what CsrGraph::indexOf expects
+    const quint32 nodeCount = quint32(nodes.size());
+    csrGraph.osmIds.reserve(nodeCount);
+    csrGraph.latitudes.reserve(nodeCount);
+    csrGraph.longitudes.reserve(nodeCount);
+    for (auto it = nodes.constBegin(); it != nodes.constEnd(); ++it) {
+        csrGraph.osmIds.append(it.key());
+        csrGraph.latitudes.append(it.value()->latitude);
+        csrGraph.longitudes.append(it.value()->longitude);
+    }
+    csrGraph.buildProjection();
+
+    // One undirected edge per stored pair; the map holds both directions
+    QVector<quint32> degree(nodeCount, 0);
+    for (auto it = edges.constBegin(); it != edges.constEnd(); ++it) {
+        if (it.key().first >= it.key().second) {
+            continue;
+        }
+        Edge *edge = it.value();
+        quint32 a = csrGraph.indexOf(edge->start->id);
+        quint32 b = csrGraph.indexOf(edge->end->id);
+        edge->index = quint32(csrGraph.edgePointers.size());
+        csrGraph.edgeSources.append(a);
+        csrGraph.edgeTargets.append(b);
+        csrGraph.edgePointers.append(edge);
+        degree[a]++;
+        degree[b]++;
+    }
+
+    csrGraph.blockedEdges.resize(csrGraph.edgeCount());
+    for (quint32 e = 0; e < csrGraph.edgeCount(); ++e) {
+        if (csrGraph.edgePointers[e]->blocked) {
+            csrGraph.blockedEdges.set(e);
+        }
+    }
+
+    csrGraph.offsets.resize(nodeCount + 1);
+    csrGraph.offsets[0] = 0;
+    for (quint32 i = 0; i < nodeCount; ++i) {
+        csrGraph.offsets[i + 1] = csrGraph.offsets[i] + degree[i];
+    }
+
+    const quint32 arcCount = csrGraph.offsets[nodeCount];
+    csrGraph.arcTargets.resize(arcCount);
+    csrGraph.arcLengths.resize(arcCount);
+    csrGraph.arcEdges.resize(arcCount);
+
+    QVector<quint32> cursor(csrGraph.offsets.constBegin(), csrGraph.offsets.constEnd() - 1);
+    for (quint32 e = 0; e < csrGraph.edgeCount(); ++e) {
+        const quint32 a = csrGraph.edgeSources[e];
+        const quint32 b = csrGraph.edgeTargets[e];
+        const double length = csrGraph.edgePointers[e]->length;
+
+        quint32 arc = cursor[a]++;
+        csrGraph.arcTargets[arc] = b;
+        csrGraph.arcLengths[arc] = length;
+        csrGraph.arcEdges[arc] = e;
+
+        arc = cursor[b]++;
+        csrGraph.arcTargets[arc] = a;
+        csrGraph.arcLengths[arc] = length;
+        csrGraph.arcEdges[arc] = e;
+    }
+
+    if (routeCacheCapacity > 0) {
+        routing.cache.reset(new RouteCache(routeCacheCapacity));
+    }
+
+    frozen = true;
+    qDebug() << "Graph frozen:" << nodeCount << "nodes," << csrGraph.edgeCount() << "edges," << arcCount << "arcs.";
+}
+
+void Graph::buildContractionHierarchy() {
+    if (!frozen) {
+        freeze();
+    }
+    QSharedPointer<ContractionHierarchy> hierarchy(new ContractionHierarchy);
+    hierarchy->build(routing.csrGraph);
+    routing.contractionHierarchy = hierarchy;
+}
+
+void Graph::buildLandmarks(int count, LandmarkSet::Selection selection) {
+    if (!frozen) {
+        freeze();
+    }
+    QSharedPointer<LandmarkSet> landmarkSet(new LandmarkSet);
+    landmarkSet->build(routing.csrGraph, count, selection);
+    routing.landmarks = landmarkSet;
+    routing.heuristicMode = landmarkSet->isEmpty() ? RoutingSnapshot::Geodesic
+                                                   : RoutingSnapshot::Landmarks;
+}
+
+int Graph::nodeCount() const {
+    return frozen ? int(routing.csrGraph.nodeCount()) : int(nodes.size());
+}
+
+qint64 Graph::nodeIdAt(int index) const {
+    if (frozen) {
+        return routing.csrGraph.osmId(quint32(index));
+    }
+    return std::next(nodes.constBegin(), index).key();
+}
+
+bool Graph::hasNode(qint64 id) const {
+    return frozen ? routing.csrGraph.indexOf(id) != CsrGraph::InvalidIndex : nodes.contains(id);
+}
+
+QGeoCoordinate Graph::coordinate(qint64 id) const {
+    if (frozen) {
+        quint32 index = routing.csrGraph.indexOf(id);
+        return index != CsrGraph::InvalidIndex ? routing.csrGraph.coordinate(index) : QGeoCoordinate();
+    }
+    Node *node = nodes.value(id, nullptr);
+    return node ? node->coordinate() : QGeoCoordinate();
+}
+
+PlanePoint Graph::position(qint64 id) const {
+    if (frozen) {
+        quint32 index = routing.csrGraph.indexOf(id);
+        return index != CsrGraph::InvalidIndex ? routing.csrGraph.position(index) : PlanePoint();
+    }
+    Node *node = nodes.value(id, nullptr);
+    return node ? routing.csrGraph.projection().project(node->latitude, node->longitude) : PlanePoint();
+}
+
 void Graph::blockEdge(qint64 startId, qint64 endId) {
     if (startId == endId) {
         qWarning() << "Cannot block an edge with the same start and end node:" << startId;
         return; // Prevent blocking self-referential edges
     }
 
-    QPair<qint64, qint64> edgeKey = qMakePair(startId, endId);
-    if (edges.contains(edgeKey)) {
-        blockedEdges.insert(edgeKey);
-        blockedEdges.insert(qMakePair(endId, startId)); // Ensure bidirectional blocking
-        edges[edgeKey]->blocked = true;
-        edges[qMakePair(endId, startId)]->blocked = true;
+    // Both directions share one Edge, so this blocks the road both ways
+    Edge *edge = edges.value(qMakePair(startId, endId), nullptr);
+    if (edge) {
+        edge->blocked = true;
+        if (frozen) {
+            routing.csrGraph.setBlocked(edge->index, true);
+            if (routing.cache) {
+                routing.cache->invalidateBlockedEdge(edge->index);
+                routing.cacheEpoch = routing.cache->epoch();
+            }
+        }
         qDebug() << "Blocked edge between" << startId << "and" << endId;
     } else {
         qWarning() << "Attempted to block a non-existent edge between" << startId << "and" << endId;
@@ -58,12 +197,16 @@ void Graph::blockEdge(qint64 startId, qint64 endId) {
 
 
 void Graph::unblockEdge(qint64 startId, qint64 endId) {
-    QPair<qint64, qint64> edgeKey = qMakePair(startId, endId);
-    if (blockedEdges.contains(edgeKey)) {
-        blockedEdges.remove(edgeKey);
-        blockedEdges.remove(qMakePair(endId, startId)); // Ensure bidirectional unblocking
-        edges[edgeKey]->blocked = false;
-        edges[qMakePair(endId, startId)]->blocked = false;
+    Edge *edge = edges.value(qMakePair(startId, endId), nullptr);
+    if (edge && edge->blocked) {
+        edge->blocked = false;
+        if (frozen) {
+            routing.csrGraph.setBlocked(edge->index, false);
+            if (routing.cache) {
+                routing.cache->invalidateUnblockedEdge(edge->index, routing);
+                routing.cacheEpoch = routing.cache->epoch();
+            }
+        }
         qDebug() << "Unblocked edge between" << startId << "and" << endId;
     } else {
         qWarning() << "Attempted to unblock a non-blocked edge between" << startId << "and" << endId;
@@ -72,12 +215,29 @@ void Graph::unblockEdge(qint64 startId, qint64 endId) {
 
 QList<QPair<qint64, qint64>> Graph::getBlockedEdges() const {
     QList<QPair<qint64, qint64>> list;
-    for (const auto &pair : blockedEdges) {
-        list.append(pair);
+    if (frozen) {
+        const CsrGraph &csrGraph = routing.csrGraph;
+        csrGraph.blocked().forEach([&](quint32 edge) {
+            list.append(qMakePair(csrGraph.osmId(csrGraph.edgeSource(edge)),
+                                  csrGraph.osmId(csrGraph.edgeTarget(edge))));
+        });
+        return list;
+    }
+    for (auto it = edges.constBegin(); it != edges.constEnd(); ++it) {
+        if (it.key().first < it.key().second && it.value()->blocked) {
+            list.append(it.key());
+        }
     }
     return list;
 }
 
+int Graph::blockedEdgeCount() const {
+    if (frozen) {
+        return routing.csrGraph.blocked().count();
+    }
+    return int(getBlockedEdges().size());
+}
+
 void Graph::placeRandomObstacles(int count) {
     int totalUniqueEdges = edges.size() / 2; // Since edges are bidirectional
     if (totalUniqueEdges == 0) {
@@ -104,7 +264,7 @@ void Graph::placeRandomObstacles(int count) {
         Edge* edge = edges.value(edgeKey);
 
         // Skip if already blocked
-        if (blockedEdges.contains(edgeKey)) {
+        if (edge->blocked) {
             attempt++;
             continue;
         }
@@ -123,161 +283,182 @@ void Graph::placeRandomObstacles(int count) {
     }
 }
 
-double Graph::heuristic(const Node &a, const Node &b) const {
-    return a.coordinate.distanceTo(b.coordinate);
+quint32 Graph::edgeIndex(qint64 startId, qint64 endId) const {
+    if (!frozen) {
+        return CsrGraph::InvalidIndex;
+    }
+    return routing.csrGraph.findEdge(routing.csrGraph.indexOf(startId), routing.csrGraph.indexOf(endId));
 }
 
 QList<Edge*> Graph::findPath(qint64 startId, qint64 endId,
-                              const QSet<QPair<qint64, qint64>> &avoidEdges)
+                              const EdgeSet &avoidEdges,
+                              SearchStats *stats)
 {
-    if (!nodes.contains(startId) || !nodes.contains(endId)) {
-        return {};
+    if (!frozen) {
+        freeze();
     }
 
-    auto compare = [](const QPair<qint64, double> &a, const QPair<qint64, double> &b) {
-        return a.second > b.second;
-    };
-    std::priority_queue<QPair<qint64, double>, std::vector<QPair<qint64, double>>, decltype(compare)> openSet(compare);
-
-    QMap<qint64, qint64> cameFrom;
-    QMap<qint64, double> gScore;
-    QMap<qint64, double> fScore;
-
-    for (auto nodeId : nodes.keys()) {
-        gScore[nodeId] = std::numeric_limits<double>::infinity();
-        fScore[nodeId] = std::numeric_limits<double>::infinity();
-    }
-
-    gScore[startId] = 0.0;
-    fScore[startId] = heuristic(*nodes[startId], *nodes[endId]);
-    openSet.push({startId, fScore[startId]});
-
-    while (!openSet.empty()) {
-        qint64 currentId = openSet.top().first;
-        openSet.pop();
-
-        if (currentId == endId) {
-            // Reconstruct the path
-            QList<Edge*> path;
-            qint64 curr = endId;
-            while (cameFrom.contains(curr)) {
-                qint64 prev = cameFrom[curr];
-                Edge *edge = edges.value(qMakePair(prev, curr));
-                if (edge) {
-                    path.prepend(edge);
-                }
-                curr = prev;
-            }
-            return path;
-        }
-
-        // Explore neighbors
-        for (Edge *neighborEdge : adjacencyList[currentId]) {
-            qint64 neighborId = (neighborEdge->start->id == currentId)
-            ? neighborEdge->end->id
-            : neighborEdge->start->id;
-
-            QPair<qint64, qint64> edgeKey = qMakePair(currentId, neighborId);
+    const quint32 start = routing.csrGraph.indexOf(startId);
+    const quint32 goal  = routing.csrGraph.indexOf(endId);
+    if (start == CsrGraph::InvalidIndex || goal == CsrGraph::InvalidIndex) {
+        return {};
+    }
+    return routing.findPath(start, goal, avoidEdges, stats);
+}
 
-            // Skip blocked edges
-            if (blockedEdges.contains(edgeKey)) {
-                continue;
-            }
+void Graph::setRouteCacheCapacity(int capacity) {
+    routeCacheCapacity = capacity;
+    if (frozen) {
+        routing.cache.reset(capacity > 0 ? new RouteCache(capacity) : nullptr);
+        routing.cacheEpoch = routing.cache ? routing.cache->epoch() : 0;
+    }
+}
 
-            // Skip any additional avoidEdges
-            if (avoidEdges.contains(edgeKey) || avoidEdges.contains(qMakePair(edgeKey.second, edgeKey.first))) {
-                continue;
-            }
+RouteCache::Stats Graph::routeCacheStats() const {
+    return routing.cache ? routing.cache->stats() : RouteCache::Stats();
+}
 
-            double tentativeGScore = gScore[currentId] + neighborEdge->length;
-            if (tentativeGScore < gScore[neighborId]) {
-                cameFrom[neighborId] = currentId;
-                gScore[neighborId]   = tentativeGScore;
-                fScore[neighborId]   = tentativeGScore + heuristic(*nodes[neighborId], *nodes[endId]);
-                openSet.push({neighborId, fScore[neighborId]});
-            }
-        }
+RoutingSnapshot Graph::snapshot() {
+    if (!frozen) {
+        freeze();
     }
-    return {};
+    return routing;
 }
 
 
 /**
  * @brief Graph::createSimplifiedGraph
- * Merges consecutive degree-2 nodes in a simple while loop.
+ * Walks every chain of degree-2 nodes once, from the junction or dead end
+ * it starts at, and replaces it by one edge carrying the chain's points.
+ * A chain that comes back to its start keeps two of its nodes and one that
+ * would duplicate an existing edge keeps its middle node, so no road is lost.
  */
 Graph Graph::createSimplifiedGraph() const
 {
-    // Make a deep copy of this graph
     Graph simplified;
 
-    // 1) Copy nodes
-    for (auto nodeId : nodes.keys()) {
-        simplified.addNode(nodeId, nodes[nodeId]->coordinate);
+    // Dense adjacency read off the edge map: its keys are sorted by their
+    // first node, like the node map, so each node's neighbours are contiguous
+    const int nodeCount = int(nodes.size());
+    QHash<qint64, int> indexOf;
+    indexOf.reserve(nodeCount);
+    QVector<const Node*> nodeAt;
+    nodeAt.reserve(nodeCount);
+    for (auto it = nodes.constBegin(); it != nodes.constEnd(); ++it) {
+        indexOf.insert(it.key(), nodeAt.size());
+        nodeAt.append(it.value());
     }
 
-    // 2) Copy edges
-    for (auto ePair : edges.keys()) {
-        auto e = edges[ePair];
-        if (!e) continue;
-        simplified.addEdge(e->start->id, e->end->id, e->length);
+    QVector<int> offsets(nodeCount + 1, 0);
+    QVector<int> neighbours;
+    QVector<const Edge*> arcEdges;
+    neighbours.reserve(edges.size());
+    arcEdges.reserve(edges.size());
+    for (auto it = edges.constBegin(); it != edges.constEnd(); ++it) {
+        offsets[indexOf.value(it.key().first) + 1]++;
+        neighbours.append(indexOf.value(it.key().second));
+        arcEdges.append(it.value());
     }
+    for (int i = 0; i < nodeCount; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+    auto degree = [&](int node) { return offsets[node + 1] - offsets[node]; };
+
+    struct Chain {
+        int last = -1;
+        double length = 0.0;
+        QVector<ShapePoint> shape;   // Every point after the first node, interior nodes included
+        QVector<int> interior;       // Degree-2 nodes passed, in order
+        QVector<int> interiorPoints; // Index of each of them in shape
+    };
 
-    // 3) Repeatedly remove degree-2 nodes
-    bool changed = true;
-    while (changed) {
-        changed = false;
-
-        // Collect nodes that have degree=2
-        QList<qint64> toRemove;
-        for (auto nId : simplified.nodes.keys()) {
-            auto edgesList = simplified.adjacencyList.value(nId);
-            if (edgesList.size() == 2) {
-                toRemove.append(nId);
+    QSet<const Edge*> visited;
+    visited.reserve(edges.size() / 2);
+
+    // Follows the chain leaving first through arc up to the next node that is
+    // not of degree 2, or back to first on a ring
+    auto walk = [&](int first, int arc) {
+        Chain chain;
+        int previous = first;
+        for (;;) {
+            const Edge *edge = arcEdges[arc];
+            const int next = neighbours[arc];
+            visited.insert(edge);
+            ShapeArena::decode(*edge, edge->start == nodeAt[previous], chain.length, chain.shape);
+            chain.length += edge->length;
+            if (degree(next) != 2 || next == first) {
+                chain.last = next;
+                return chain;
             }
+            chain.interior.append(next);
+            chain.interiorPoints.append(chain.shape.size());
+            chain.shape.append(ShapePoint{nodeAt[next]->latitude, nodeAt[next]->longitude, chain.length});
+            arc = neighbours[offsets[next]] == previous ? offsets[next] + 1 : offsets[next];
+            previous = next;
         }
+    };
 
-        for (auto midId : toRemove) {
-            auto edgesList = simplified.adjacencyList.value(midId);
-            // Could be empty if we removed it in the same pass
-            if (edgesList.size() != 2) {
-                continue;
-            }
-
-            // Neighbors are A and B
-            Edge *edge1 = edgesList[0];
-            Edge *edge2 = edgesList[1];
+    auto keepNode = [&](int node) {
+        simplified.addNode(nodeAt[node]->id, nodeAt[node]->latitude, nodeAt[node]->longitude);
+    };
 
-            // Identify A, B
-            qint64 aId = (edge1->start->id == midId) ? edge1->end->id : edge1->start->id;
-            qint64 bId = (edge2->start->id == midId) ? edge2->end->id : edge2->start->id;
+    // Adds chain as edges joining first, the kept interior nodes and its last node
+    auto addChain = [&](int first, const Chain &chain) {
+        QVector<int> kept;
+        const int interiorCount = chain.interior.size();
+        const bool loop = chain.last == first;
+        if (loop) {
+            if (interiorCount < 2) {
+                return; // Would need a parallel edge, which the edge map cannot hold
+            }
+            kept = {interiorCount / 3, 2 * interiorCount / 3};
+        } else if (interiorCount > 0
+                   && (edges.contains(qMakePair(nodeAt[first]->id, nodeAt[chain.last]->id))
+                       || simplified.edges.contains(qMakePair(nodeAt[first]->id, nodeAt[chain.last]->id)))) {
+            kept = {interiorCount / 2};
+        } else if (simplified.edges.contains(qMakePair(nodeAt[first]->id, nodeAt[chain.last]->id))) {
+            return;
+        }
 
-            // Combine distance
-            double newLen = edge1->length + edge2->length;
+        int from = first;
+        int fromPoint = -1;
+        double fromOffset = 0.0;
+        for (int k = 0; k <= kept.size(); ++k) {
+            const bool atEnd = k == kept.size();
+            const int to = atEnd ? chain.last : chain.interior[kept[k]];
+            const int toPoint = atEnd ? chain.shape.size() : chain.interiorPoints[kept[k]];
+            const double toOffset = atEnd ? chain.length : chain.shape[toPoint].offset;
+
+            QVector<ShapePoint> shape(chain.shape.cbegin() + fromPoint + 1, chain.shape.cbegin() + toPoint);
+            for (ShapePoint &point : shape) {
+                point.offset -= fromOffset;
+            }
+            keepNode(to);
+            simplified.addEdge(nodeAt[from]->id, nodeAt[to]->id, toOffset - fromOffset, shape);
 
-            // Remove midId from the graph
-            for (Edge *e : edgesList) {
-                auto p1 = qMakePair(e->start->id, e->end->id);
-                auto p2 = qMakePair(e->end->id, e->start->id);
-                simplified.edges.remove(p1);
-                simplified.edges.remove(p2);
+            from = to;
+            fromPoint = toPoint;
+            fromOffset = toOffset;
+        }
+    };
 
-                // Remove adjacency references
-                simplified.adjacencyList[e->start->id].removeAll(e);
-                simplified.adjacencyList[e->end->id].removeAll(e);
-                delete e;
-            }
-            simplified.adjacencyList.remove(midId);
-            delete simplified.nodes[midId];
-            simplified.nodes.remove(midId);
-
-            // Add new edge A-B if it doesn’t already exist
-            auto pAB = qMakePair(aId, bId);
-            auto pBA = qMakePair(bId, aId);
-            if (!simplified.edges.contains(pAB) && !simplified.edges.contains(pBA)) {
-                simplified.addEdge(aId, bId, newLen);
+    for (int i = 0; i < nodeCount; ++i) {
+        if (degree(i) == 2) {
+            continue;
+        }
+        keepNode(i);
+        for (int arc = offsets[i]; arc < offsets[i + 1]; ++arc) {
+            if (!visited.contains(arcEdges[arc])) {
+                addChain(i, walk(i, arc));
             }
-            changed = true;
+        }
+    }
+
+    // Whatever is left are rings without any junction
+    for (int i = 0; i < nodeCount; ++i) {
+        if (degree(i) == 2 && !visited.contains(arcEdges[offsets[i]])) {
+            keepNode(i);
+            addChain(i, walk(i, offsets[i]));
         }
     }
 
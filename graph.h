@@ -7,35 +7,108 @@
 #include <QSet>
 #include <QGeoCoordinate>
 #include <QPair>
+#include <QSharedPointer>
+#include <QVector>
 #include "node.h"
 #include "edge.h"
+#include "shapearena.h"
+#include "routingsnapshot.h"
 
 class Graph {
 public:
+    using Heuristic = RoutingSnapshot::Heuristic;
+
     Graph();
 
-    void addNode(qint64 id, const QGeoCoordinate &coordinate);
-    void addEdge(qint64 startId, qint64 endId, double length);
+    void addNode(qint64 id, double latitude, double longitude);
+    // shape: road points between the two nodes, oriented from startId
+    void addEdge(qint64 startId, qint64 endId, double length, const QVector<ShapePoint> &shape = {});
 
     /**
      * @brief findPath
-     * A* to find a path from startId to endId.
+     * Shortest path from startId to endId. Uses the contraction hierarchy
+     * when one is built and falls back to A* if its route crosses a blocked
+     * or avoided edge.
      */
     QList<Edge*> findPath(qint64 startId, qint64 endId,
-                           const QSet<QPair<qint64, qint64>> &avoidEdges = {});
+                           const EdgeSet &avoidEdges = {},
+                           SearchStats *stats = nullptr);
+
+    /**
+     * @brief snapshot
+     * Immutable copy of the current routing state (blocked flags included)
+     * for queries off the GUI thread. Freezes the graph if needed.
+     */
+    RoutingSnapshot snapshot();
+
+    /**
+     * @brief setRouteCacheCapacity
+     * Number of routes findPath keeps per frozen graph; 0 disables the cache.
+     * Changing it drops the cached routes.
+     */
+    void setRouteCacheCapacity(int capacity);
+    RouteCache::Stats routeCacheStats() const;
 
     /**
      * @brief createSimplifiedGraph
-     * Creates and returns a new Graph that merges consecutive degree-2 nodes into single edges.
+     * Creates and returns a new Graph where each chain of degree-2 nodes
+     * becomes a single edge that keeps the chain's points as its shape.
      */
     Graph createSimplifiedGraph() const;
 
+    /**
+     * @brief freeze
+     * Builds the contiguous CSR view used by routing and simulation.
+     * The QMap-based members stay valid as the building layer; adding nodes
+     * or edges afterwards drops the CSR view until the next freeze().
+     */
+    void freeze();
+    bool isFrozen() const { return frozen; }
+    const CsrGraph& csr() const { return routing.csrGraph; }
+
+    /**
+     * @brief buildContractionHierarchy
+     * Preprocesses the frozen graph for fast queries. Call after freeze();
+     * a later freeze() discards the hierarchy.
+     */
+    void buildContractionHierarchy();
+    bool hasContractionHierarchy() const { return routing.hasContractionHierarchy(); }
+    void dropContractionHierarchy() { routing.contractionHierarchy.reset(); }
+
+    /**
+     * @brief buildLandmarks
+     * Selects count landmarks on the frozen graph, stores their distance
+     * tables and switches A* to the ALT heuristic.
+     */
+    void buildLandmarks(int count, LandmarkSet::Selection selection = LandmarkSet::Avoid);
+    void setHeuristic(Heuristic mode) { routing.heuristicMode = mode; }
+    Heuristic heuristic() const { return routing.heuristicMode; }
+
+    // Node access that goes through the CSR view once the graph is frozen
+    int nodeCount() const;
+    qint64 nodeIdAt(int index) const;
+    bool hasNode(qint64 id) const;
+    QGeoCoordinate coordinate(qint64 id) const;
+    PlanePoint position(qint64 id) const;
+    const LocalProjection &projection() const { return routing.csrGraph.projection(); }
+
+    /**
+     * @brief edgeIndex
+     * Dense CSR edge index joining two OSM node ids, or CsrGraph::InvalidIndex.
+     * Edge::index gives the same id without the lookup.
+     */
+    quint32 edgeIndex(qint64 startId, qint64 endId) const;
+
+    // Routing helper shared with the incremental planner
+    double estimate(quint32 a, quint32 b) const { return routing.estimate(a, b); }
+
     QMap<qint64, Node*> nodes;
 
     const QMap<QPair<qint64, qint64>, Edge*>& getEdges() const { return edges; }
 
     // New Methods for Obstacles
-    QList<QPair<qint64, qint64>> getBlockedEdges() const; // Declaration only
+    QList<QPair<qint64, qint64>> getBlockedEdges() const; // One (start, end) pair per blocked edge
+    int blockedEdgeCount() const;
     void placeRandomObstacles(int count);
     void blockEdge(qint64 startId, qint64 endId);
     void unblockEdge(qint64 startId, qint64 endId);
@@ -44,12 +117,20 @@ private:
     QMap<QPair<qint64, qint64>, Edge*> edges;
     QMap<qint64, QList<Edge*>> adjacencyList;
 
-    // Set to store blocked edges as pairs of node IDs
-    QSet<QPair<qint64, qint64>> blockedEdges;
+    // Live routing state; snapshot() hands out copies of it
+    RoutingSnapshot routing;
+    bool frozen = false;
+    int routeCacheCapacity = RouteCache::DefaultCapacity;
+
+    // Road shapes of the edges; shared by copies so their edges stay valid
+    QSharedPointer<ShapeArena> shapes;
 
-    double heuristic(const Node &a, const Node &b) const;
+    // Node and Edge objects of a graph read by GraphSnapshot, one block each
+    QVector<Node> nodeStorage;
+    QVector<Edge> edgeStorage;
 
     friend class OSMImporter;
+    friend class GraphSnapshot;
 };
 
 #endif // GRAPH_H
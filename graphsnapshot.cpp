@@ -0,0 +1,466 @@
+#include "graphsnapshot.h"
+#include "contractionhierarchy.h"
+#include "landmarks.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+enum SnapshotFlag : quint32 {
+    HasHierarchy = 0x1,
+    HasLandmarks = 0x2
+};
+
+constexpr char Magic[8] = {'P', 'R', 'G', 'R', 'A', 'P', 'H', '\0'};
+constexpr quint32 ByteOrderMark = 0x01020304u;
+
+struct SnapshotHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;      // ByteOrderMark as written by the producing machine
+    quint64 payloadSize;    // Bytes following the header
+    quint64 checksum;       // payloadChecksum() of those bytes
+    double south;
+    double west;
+    double north;
+    double east;
+    quint32 flags;
+    quint32 fingerprintSize;
+    quint32 nodeCount;
+    quint32 edgeCount;
+    quint32 arcCount;
+    quint32 hierarchyEdgeCount;
+    quint32 upArcCount;
+    quint32 shortcutCount;
+    quint32 landmarkCount;
+    quint32 heuristic;
+    quint32 shapeByteCount;
+    quint32 reserved;
+};
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "sections must start 8-byte aligned");
+
+// Word-wise multiply-xor hash; catches truncation and bit rot, not tampering
+quint64 payloadChecksum(const uchar *data, qint64 size) {
+    quint64 hash = 0x9e3779b97f4a7c15ULL ^ quint64(size);
+    qint64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+qint64 paddedSize(qint64 bytes) {
+    return (bytes + 7) & ~qint64(7);
+}
+
+void appendSection(QByteArray &payload, const void *data, qint64 bytes) {
+    payload.append(static_cast<const char *>(data), bytes);
+    payload.append(QByteArray(paddedSize(bytes) - bytes, '\0'));
+}
+
+template <typename T>
+void appendSection(QByteArray &payload, const QVector<T> &values) {
+    appendSection(payload, values.constData(), values.size() * qint64(sizeof(T)));
+}
+
+// Walks the sections of a mapped payload; any overrun marks the reader failed
+class SectionReader {
+public:
+    SectionReader(const uchar *data, qint64 size) : cursor(data), end(data + size) {}
+
+    bool isValid() const { return valid; }
+    bool atEnd() const { return cursor == end; }
+
+    const uchar *take(qint64 bytes) {
+        const qint64 padded = paddedSize(bytes);
+        if (!valid || bytes < 0 || padded > end - cursor) {
+            valid = false;
+            return nullptr;
+        }
+        const uchar *section = cursor;
+        cursor += padded;
+        return section;
+    }
+
+    template <typename T>
+    QVector<T> takeArray(qint64 count) {
+        const T *values = reinterpret_cast<const T *>(take(count * qint64(sizeof(T))));
+        return values ? QVector<T>(values, values + count) : QVector<T>();
+    }
+
+private:
+    const uchar *cursor;
+    const uchar *end;
+    bool valid = true;
+};
+
+bool allBelow(const QVector<quint32> &values, quint32 limit) {
+    return std::all_of(values.cbegin(), values.cend(), [limit](quint32 value) { return value < limit; });
+}
+
+// CSR offsets: never decreasing, ending at the arc count
+bool validOffsets(const QVector<quint32> &offsets, quint32 arcCount) {
+    for (qsizetype i = 1; i < offsets.size(); ++i) {
+        if (offsets[i] < offsets[i - 1]) {
+            return false;
+        }
+    }
+    return !offsets.isEmpty() && offsets.last() == arcCount;
+}
+
+// A shape is pointCount triples of varints (at most ten bytes each) that
+// must all end inside the shape section
+bool shapeFits(const QVector<quint8> &bytes, quint32 offset, quint32 pointCount) {
+    qsizetype cursor = offset;
+    for (quint64 varints = quint64(pointCount) * 3; varints > 0; --varints) {
+        for (int length = 1;; ++length) {
+            if (cursor >= bytes.size() || length > 10) {
+                return false;
+            }
+            if (!(bytes[cursor++] & 0x80)) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool GraphSnapshot::write(const Graph &graph, const QString &path, const QByteArray &fingerprint) {
+    error.clear();
+    if (!graph.isFrozen()) {
+        error = QStringLiteral("graph is not frozen");
+        return false;
+    }
+
+    const RoutingSnapshot &routing = graph.routing;
+    const CsrGraph &csr = routing.csrGraph;
+    const ContractionHierarchy *hierarchy = routing.contractionHierarchy.data();
+    const LandmarkSet *landmarks = routing.landmarks.data();
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.south = 90.0;
+    header.west = 180.0;
+    header.north = -90.0;
+    header.east = -180.0;
+    for (quint32 i = 0; i < csr.nodeCount(); ++i) {
+        header.south = qMin(header.south, csr.latitudes[i]);
+        header.north = qMax(header.north, csr.latitudes[i]);
+        header.west = qMin(header.west, csr.longitudes[i]);
+        header.east = qMax(header.east, csr.longitudes[i]);
+    }
+    header.fingerprintSize = quint32(fingerprint.size());
+    header.nodeCount = csr.nodeCount();
+    header.edgeCount = csr.edgeCount();
+    header.arcCount = csr.arcCount();
+    header.heuristic = quint32(routing.heuristicMode);
+
+    // Edge lengths live on the Edge objects, not in the CSR arrays
+    QVector<double> edgeLengths(csr.edgeCount());
+    for (quint32 e = 0; e < csr.edgeCount(); ++e) {
+        edgeLengths[e] = csr.edgePointers[e]->length;
+    }
+
+    // Road shapes are written as the graph's arena plus where each edge's lies in it
+    QVector<quint32> shapeOffsets(csr.edgeCount());
+    QVector<quint32> shapeSizes(csr.edgeCount());
+    for (quint32 e = 0; e < csr.edgeCount(); ++e) {
+        const Edge *edge = csr.edgePointers[e];
+        if (edge->hasShape() && edge->shapeArena != graph.shapes.data()) {
+            error = QStringLiteral("edge shape outside the graph's arena");
+            return false;
+        }
+        shapeOffsets[e] = edge->shapeOffset;
+        shapeSizes[e] = edge->shapeSize;
+    }
+    header.shapeByteCount = quint32(graph.shapes->bytes.size());
+
+    QByteArray payload;
+    appendSection(payload, fingerprint.constData(), fingerprint.size());
+    appendSection(payload, csr.osmIds);
+    appendSection(payload, csr.latitudes);
+    appendSection(payload, csr.longitudes);
+    appendSection(payload, csr.offsets);
+    appendSection(payload, csr.arcTargets);
+    appendSection(payload, csr.arcLengths);
+    appendSection(payload, csr.arcEdges);
+    appendSection(payload, csr.edgeSources);
+    appendSection(payload, csr.edgeTargets);
+    appendSection(payload, edgeLengths);
+    appendSection(payload, shapeOffsets);
+    appendSection(payload, shapeSizes);
+    appendSection(payload, graph.shapes->bytes);
+
+    if (hierarchy && !hierarchy->isEmpty()) {
+        header.flags |= HasHierarchy;
+        header.hierarchyEdgeCount = quint32(hierarchy->hierarchyEdges.size());
+        header.upArcCount = quint32(hierarchy->upTargets.size());
+        header.shortcutCount = quint32(hierarchy->shortcutTotal);
+        appendSection(payload, hierarchy->hierarchyEdges);
+        appendSection(payload, hierarchy->upOffsets);
+        appendSection(payload, hierarchy->upTargets);
+        appendSection(payload, hierarchy->upWeights);
+        appendSection(payload, hierarchy->upEdges);
+    }
+    if (landmarks && !landmarks->isEmpty()) {
+        header.flags |= HasLandmarks;
+        header.landmarkCount = quint32(landmarks->count());
+        appendSection(payload, landmarks->landmarks);
+        appendSection(payload, landmarks->distances);
+    }
+
+    header.payloadSize = quint64(payload.size());
+    header.checksum = payloadChecksum(reinterpret_cast<const uchar *>(payload.constData()), payload.size());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header))
+        || file.write(payload) != payload.size()
+        || !file.commit()) {
+        error = file.errorString();
+        return false;
+    }
+
+    qDebug() << "Graph snapshot written to" << path << ":" << header.nodeCount << "nodes,"
+             << header.edgeCount << "edges," << (sizeof(header) + payload.size()) << "bytes.";
+    return true;
+}
+
+bool GraphSnapshot::read(Graph &graph, const QString &path, const QByteArray &expectedFingerprint) {
+    error.clear();
+    if (!graph.nodes.isEmpty()) {
+        error = QStringLiteral("target graph is not empty");
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    const qint64 fileSize = file.size();
+    if (fileSize < qint64(sizeof(SnapshotHeader))) {
+        error = QStringLiteral("file too short");
+        return false;
+    }
+    const uchar *data = file.map(0, fileSize);
+    if (!data) {
+        error = file.errorString();
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        error = QStringLiteral("not a graph snapshot");
+        return false;
+    }
+    if (header.byteOrder != ByteOrderMark) {
+        error = QStringLiteral("written on a machine of another byte order");
+        return false;
+    }
+    if (header.version != Version) {
+        error = QStringLiteral("snapshot version %1, expected %2").arg(header.version).arg(Version);
+        return false;
+    }
+    if (header.payloadSize != quint64(fileSize) - sizeof(header)) {
+        error = QStringLiteral("truncated snapshot");
+        return false;
+    }
+
+    const uchar *payload = data + sizeof(header);
+    if (payloadChecksum(payload, qint64(header.payloadSize)) != header.checksum) {
+        error = QStringLiteral("checksum mismatch");
+        return false;
+    }
+
+    SectionReader reader(payload, qint64(header.payloadSize));
+    const uchar *fingerprint = reader.take(header.fingerprintSize);
+    if (!expectedFingerprint.isEmpty()
+        && (!fingerprint || QByteArray(reinterpret_cast<const char *>(fingerprint), header.fingerprintSize)
+                                != expectedFingerprint)) {
+        error = QStringLiteral("snapshot built from another source");
+        return false;
+    }
+
+    const quint32 nodeCount = header.nodeCount;
+    const quint32 edgeCount = header.edgeCount;
+    CsrGraph csr;
+    csr.osmIds = reader.takeArray<qint64>(nodeCount);
+    csr.latitudes = reader.takeArray<double>(nodeCount);
+    csr.longitudes = reader.takeArray<double>(nodeCount);
+    csr.offsets = reader.takeArray<quint32>(qint64(nodeCount) + 1);
+    csr.arcTargets = reader.takeArray<quint32>(header.arcCount);
+    csr.arcLengths = reader.takeArray<double>(header.arcCount);
+    csr.arcEdges = reader.takeArray<quint32>(header.arcCount);
+    csr.edgeSources = reader.takeArray<quint32>(edgeCount);
+    csr.edgeTargets = reader.takeArray<quint32>(edgeCount);
+    const QVector<double> edgeLengths = reader.takeArray<double>(edgeCount);
+    const QVector<quint32> shapeOffsets = reader.takeArray<quint32>(edgeCount);
+    const QVector<quint32> shapeSizes = reader.takeArray<quint32>(edgeCount);
+    QVector<quint8> shapeBytes = reader.takeArray<quint8>(header.shapeByteCount);
+
+    QSharedPointer<ContractionHierarchy> hierarchy;
+    if (header.flags & HasHierarchy) {
+        hierarchy.reset(new ContractionHierarchy);
+        hierarchy->nodeCount = nodeCount;
+        hierarchy->shortcutTotal = int(header.shortcutCount);
+        hierarchy->hierarchyEdges = reader.takeArray<ContractionHierarchy::HierarchyEdge>(header.hierarchyEdgeCount);
+        hierarchy->upOffsets = reader.takeArray<quint32>(qint64(nodeCount) + 1);
+        hierarchy->upTargets = reader.takeArray<quint32>(header.upArcCount);
+        hierarchy->upWeights = reader.takeArray<double>(header.upArcCount);
+        hierarchy->upEdges = reader.takeArray<quint32>(header.upArcCount);
+    }
+
+    QSharedPointer<LandmarkSet> landmarks;
+    if (header.flags & HasLandmarks) {
+        landmarks.reset(new LandmarkSet);
+        landmarks->nodeCount = nodeCount;
+        landmarks->landmarks = reader.takeArray<quint32>(header.landmarkCount);
+        landmarks->distances = reader.takeArray<double>(qint64(nodeCount) * header.landmarkCount);
+    }
+
+    if (!reader.isValid() || !reader.atEnd()
+        || !validOffsets(csr.offsets, header.arcCount)) {
+        error = QStringLiteral("inconsistent section sizes");
+        return false;
+    }
+
+    // The checksum only catches damage: a well-formed file with wrong indices
+    // must still fail here rather than be read out of bounds later
+    if (!allBelow(csr.arcTargets, nodeCount) || !allBelow(csr.arcEdges, edgeCount)) {
+        error = QStringLiteral("arc points outside the graph");
+        return false;
+    }
+    for (quint32 e = 0; e < edgeCount; ++e) {
+        if (csr.edgeSources[e] >= nodeCount || csr.edgeTargets[e] >= nodeCount) {
+            error = QStringLiteral("edge %1 points outside the graph").arg(e);
+            return false;
+        }
+        if (!shapeFits(shapeBytes, shapeOffsets[e], shapeSizes[e])) {
+            error = QStringLiteral("shape of edge %1 overruns the shape section").arg(e);
+            return false;
+        }
+    }
+    if (hierarchy) {
+        const quint32 hierarchyEdgeCount = quint32(hierarchy->hierarchyEdges.size());
+        bool valid = validOffsets(hierarchy->upOffsets, header.upArcCount)
+                     && allBelow(hierarchy->upTargets, nodeCount)
+                     && allBelow(hierarchy->upEdges, hierarchyEdgeCount);
+        for (quint32 h = 0; valid && h < hierarchyEdgeCount; ++h) {
+            // Shortcuts only join edges created before them, so unpacking ends
+            const ContractionHierarchy::HierarchyEdge &edge = hierarchy->hierarchyEdges[h];
+            valid = edge.a < nodeCount && edge.b < nodeCount
+                    && (edge.originalEdge != CsrGraph::InvalidIndex
+                            ? edge.originalEdge < edgeCount
+                            : edge.middle < nodeCount && edge.childA < h && edge.childB < h);
+        }
+        if (!valid) {
+            error = QStringLiteral("contraction hierarchy points outside the graph");
+            return false;
+        }
+    }
+    if (landmarks && !allBelow(landmarks->landmarks, nodeCount)) {
+        error = QStringLiteral("landmark points outside the graph");
+        return false;
+    }
+    file.close();
+
+    csr.buildProjection();
+    graph.shapes->bytes = std::move(shapeBytes);
+
+    // Building layer: one block of Node and one of Edge objects. Both vectors
+    // are reserved up front and never grow, so the pointers stay stable.
+    graph.nodeStorage.reserve(nodeCount);
+    for (quint32 i = 0; i < nodeCount; ++i) {
+        graph.nodeStorage.append(Node(csr.osmIds[i], csr.latitudes[i], csr.longitudes[i]));
+    }
+    graph.edgeStorage.reserve(edgeCount);
+    csr.blockedEdges.resize(edgeCount);
+    csr.edgePointers.resize(edgeCount);
+    for (quint32 e = 0; e < edgeCount; ++e) {
+        graph.edgeStorage.append(Edge(&graph.nodeStorage[csr.edgeSources[e]],
+                                      &graph.nodeStorage[csr.edgeTargets[e]], edgeLengths[e]));
+        csr.edgePointers[e] = &graph.edgeStorage[e];
+        graph.edgeStorage[e].index = e;
+        if (shapeSizes[e] > 0) {
+            graph.edgeStorage[e].shapeArena = graph.shapes.data();
+            graph.edgeStorage[e].shapeOffset = shapeOffsets[e];
+            graph.edgeStorage[e].shapeSize = shapeSizes[e];
+        }
+    }
+
+    // The maps are filled in key order so every insertion lands at the end
+    for (quint32 i = 0; i < nodeCount; ++i) {
+        Node *node = &graph.nodeStorage[i];
+        graph.nodes.insert(graph.nodes.cend(), node->id, node);
+        if (csr.offsets[i] == csr.offsets[i + 1]) {
+            continue;
+        }
+        QList<Edge*> incident;
+        incident.reserve(csr.offsets[i + 1] - csr.offsets[i]);
+        for (quint32 arc = csr.offsets[i]; arc < csr.offsets[i + 1]; ++arc) {
+            incident.append(csr.edgePointers[csr.arcEdges[arc]]);
+        }
+        graph.adjacencyList.insert(graph.adjacencyList.cend(), node->id, incident);
+    }
+
+    QVector<QPair<QPair<qint64, qint64>, Edge*>> keyedEdges;
+    keyedEdges.reserve(qsizetype(edgeCount) * 2);
+    for (quint32 e = 0; e < edgeCount; ++e) {
+        Edge *edge = csr.edgePointers[e];
+        keyedEdges.append(qMakePair(qMakePair(edge->start->id, edge->end->id), edge));
+        keyedEdges.append(qMakePair(qMakePair(edge->end->id, edge->start->id), edge));
+    }
+    std::sort(keyedEdges.begin(), keyedEdges.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    for (const auto &keyed : std::as_const(keyedEdges)) {
+        graph.edges.insert(graph.edges.cend(), keyed.first, keyed.second);
+    }
+
+    graph.routing = RoutingSnapshot();
+    graph.routing.csrGraph = std::move(csr);
+    graph.routing.contractionHierarchy = hierarchy;
+    graph.routing.landmarks = landmarks;
+    graph.routing.heuristicMode = landmarks && header.heuristic == RoutingSnapshot::Landmarks
+                                      ? RoutingSnapshot::Landmarks : RoutingSnapshot::Geodesic;
+    if (graph.routeCacheCapacity > 0) {
+        graph.routing.cache.reset(new RouteCache(graph.routeCacheCapacity));
+    }
+    graph.frozen = true;
+
+    qDebug() << "Graph snapshot loaded from" << path << "in" << timer.elapsed() << "ms:"
+             << nodeCount << "nodes," << edgeCount << "edges.";
+    return true;
+}
+
+QByteArray GraphSnapshot::fileFingerprint(const QString &path) {
+    const QFileInfo info(path);
+    return QStringLiteral("file:%1:%2:%3")
+        .arg(info.absoluteFilePath())
+        .arg(info.size())
+        .arg(info.lastModified().toMSecsSinceEpoch())
+        .toUtf8();
+}
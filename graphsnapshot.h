@@ -0,0 +1,63 @@
+#ifndef GRAPHSNAPSHOT_H
+#define GRAPHSNAPSHOT_H
+
+#include <QByteArray>
+#include <QString>
+#include "graph.h"
+
+/**
+ * @brief The GraphSnapshot class
+ * Versioned binary file holding a simplified, frozen graph ready for
+ * routing, so a known map skips the import, simplification and
+ * preprocessing at start-up.
+ *
+ * The file is a fixed header (magic, version, counts, bounding box, payload
+ * checksum) followed by 8-byte aligned sections: the source fingerprint,
+ * then OSM ids, coordinates, CSR adjacency, edge data and road shapes, then the
+ * contraction hierarchy and landmark tables when the graph had them. Every
+ * section is a raw array in the byte order of the machine that wrote it,
+ * which the header records.
+ *
+ * read() maps the file and checks it, but the load is not zero-copy. Each
+ * section is copied into its QVector with one memcpy, because CsrGraph, the
+ * hierarchy and the landmarks own their arrays and a QVector cannot point
+ * into a mapping; the mapping is released before read() returns. The Node
+ * and Edge objects are placed in one block each. The nodes, edges and
+ * adjacencyList maps the simulation looks up by OSM id are rebuilt in key
+ * order, and still allocate one entry per node and per edge direction.
+ */
+class GraphSnapshot {
+public:
+    static constexpr quint32 Version = 3;
+
+    GraphSnapshot() = default;
+
+    /**
+     * @brief write
+     * Saves a frozen graph (blocked flags are not kept). The source
+     * fingerprint identifies what the graph was built from, so a stale
+     * cache is never loaded for another map.
+     */
+    bool write(const Graph &graph, const QString &path, const QByteArray &fingerprint);
+
+    /**
+     * @brief read
+     * Loads path into an empty graph. Fails if the file is truncated,
+     * corrupt, of another version, or built from another source when
+     * expectedFingerprint is not empty.
+     */
+    bool read(Graph &graph, const QString &path, const QByteArray &expectedFingerprint = QByteArray());
+
+    QString errorString() const { return error; }
+
+    /**
+     * @brief fileFingerprint
+     * Fingerprint of a source file: absolute path, size and modification time.
+     */
+    static QByteArray fileFingerprint(const QString &path);
+
+private:
+    QString error;
+};
+
+#endif // GRAPHSNAPSHOT_H
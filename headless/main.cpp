@@ -0,0 +1,147 @@
+// main.cpp (headless runner)
+// Runs the simulation without any window, map or network access.
+//
+// Usage: projet-reseau-headless --osm map.osm [--vehicles N] [--duration s]
+//                               [--dt s] [--obstacles N] [--metrics out.json]
+//                               [--seed n] [--threads N] [--snapshot graph.snapshot]
+// Loads and prepares the graph like the application does (or reads it from
+// the --snapshot file when that was built from the same --osm file, and
+// writes the file otherwise), steps the
+// simulation by a fixed dt as fast as the CPU allows until the simulated
+// duration is reached, then writes the run metrics as JSON. With the same
+// seed, map and dt the run is identical whatever --threads is.
+
+#include "graphsnapshot.h"
+#include "osmparser.h"
+#include "simulationmanager.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QDebug>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("projet-reseau-headless");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Simulation V2V sans interface graphique");
+    parser.addHelpOption();
+    QCommandLineOption osmOption("osm", "OSM file to load (.osm XML or .osm.pbf).", "file");
+    QCommandLineOption vehiclesOption("vehicles", "Number of vehicles (default 1000).", "count", "1000");
+    QCommandLineOption durationOption("duration", "Simulated duration in seconds (default 600).", "seconds", "600");
+    QCommandLineOption dtOption("dt", "Simulation step in seconds (default 0.1).", "seconds", "0.1");
+    QCommandLineOption obstaclesOption("obstacles", "Extra obstacles placed at start (default 30).", "count", "30");
+    QCommandLineOption metricsOption("metrics", "Write the metrics JSON here instead of stdout.", "file");
+    QCommandLineOption seedOption("seed", "Random seed (default: random).", "n");
+    QCommandLineOption threadsOption("threads", "Threads for PBF decoding and the vehicle update (default: all cores).", "count");
+    QCommandLineOption snapshotOption("snapshot", "Prepared graph cache: read if built from --osm, written otherwise.", "file");
+    parser.addOptions({osmOption, vehiclesOption, durationOption, dtOption, obstaclesOption, metricsOption,
+                       seedOption, threadsOption, snapshotOption});
+    parser.process(app);
+
+    if (!parser.isSet(osmOption) && !parser.isSet(snapshotOption)) {
+        qCritical() << "Missing --osm <file> or --snapshot <file>.";
+        parser.showHelp(1);
+    }
+
+    const int vehicleCount = parser.value(vehiclesOption).toInt();
+    const double duration = parser.value(durationOption).toDouble();
+    const double dt = parser.value(dtOption).toDouble();
+    if (vehicleCount <= 0 || duration <= 0.0 || dt <= 0.0) {
+        qCritical() << "--vehicles, --duration and --dt must be positive.";
+        return 1;
+    }
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+
+    Graph graph;
+    Graph fullGraph;
+    OSMParser osmParser(fullGraph);
+    GraphSnapshot snapshot;
+    // Without --osm the snapshot is trusted as is
+    const QByteArray fingerprint = parser.isSet(osmOption) ? GraphSnapshot::fileFingerprint(parser.value(osmOption))
+                                                           : QByteArray();
+    bool snapshotLoaded = false;
+    if (parser.isSet(snapshotOption)) {
+        snapshotLoaded = snapshot.read(graph, parser.value(snapshotOption), fingerprint);
+        if (!snapshotLoaded) {
+            qWarning() << "Snapshot not used:" << snapshot.errorString();
+        }
+    }
+
+    if (!snapshotLoaded) {
+        if (!parser.isSet(osmOption)) {
+            qCritical() << "No usable snapshot and no --osm file.";
+            return 1;
+        }
+        if (parser.isSet(threadsOption)) {
+            osmParser.setThreadCount(parser.value(threadsOption).toInt());
+        }
+        if (!osmParser.parseFile(parser.value(osmOption))
+            || fullGraph.nodes.isEmpty() || fullGraph.getEdges().isEmpty()) {
+            qCritical() << "Erreur lors de l'import des données OSM:" << osmParser.errorString();
+            return 1;
+        }
+
+        graph = fullGraph.createSimplifiedGraph();
+        graph.freeze();
+        graph.buildContractionHierarchy();
+        graph.buildLandmarks(16);
+
+        if (parser.isSet(snapshotOption) && !snapshot.write(graph, parser.value(snapshotOption), fingerprint)) {
+            qWarning() << "Cannot write the snapshot:" << snapshot.errorString();
+        }
+    }
+    const qint64 loadMs = wallTimer.restart();
+
+    const quint64 seed = parser.isSet(seedOption) ? parser.value(seedOption).toULongLong()
+                                                  : QRandomGenerator::global()->generate64();
+    SimulationManager simulation(graph, seed);
+    if (parser.isSet(threadsOption)) {
+        simulation.vehicleStore().setThreadCount(parser.value(threadsOption).toInt());
+    }
+    // Batch work: no pacing, the whole run is stepped synchronously below
+    simulation.clock().stop();
+    simulation.clock().setMode(SimulationClock::FreeRunning);
+    simulation.clock().setTimeStep(dt);
+    simulation.placeRandomObstacles(parser.value(obstaclesOption).toInt());
+    QRandomGenerator startNodes(quint32(seed ^ (seed >> 32)) ^ 0x5eedu);
+    for (int i = 0; i < vehicleCount; ++i) {
+        simulation.addVehicle(i, graph.nodeIdAt(startNodes.bounded(graph.nodeCount())));
+    }
+    const qint64 setupMs = wallTimer.restart();
+
+    simulation.clock().runFor(duration);
+    const qint64 runMs = wallTimer.elapsed();
+
+    QVariantMap metrics = simulation.metrics();
+    metrics["graphNodes"] = graph.nodeCount();
+    metrics["graphEdges"] = int(graph.csr().edgeCount());
+    metrics["dtSeconds"] = dt;
+    metrics["loadMs"] = loadMs;
+    metrics["snapshotLoaded"] = snapshotLoaded;
+    metrics["importNodesPerSecond"] = osmParser.nodesPerSecond();
+    metrics["setupMs"] = setupMs;
+    metrics["runMs"] = runMs;
+    metrics["realTimeFactor"] = runMs > 0 ? duration * 1000.0 / runMs : 0.0;
+
+    const QByteArray json = QJsonDocument(QJsonObject::fromVariantMap(metrics)).toJson();
+    if (parser.isSet(metricsOption)) {
+        QFile file(parser.value(metricsOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical() << "Cannot write metrics to" << file.fileName() << ":" << file.errorString();
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
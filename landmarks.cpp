@@ -0,0 +1,205 @@
+// landmarks.cpp
+#include "landmarks.h"
+#include "searchworkspace.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double INF = std::numeric_limits<double>::infinity();
+
+struct ShortestPathTree {
+    QVector<double> distances;
+    QVector<quint32> parents;
+    QVector<quint32> settleOrder;
+};
+
+// Plain Dijkstra over open edge lengths, ignoring blocked flags
+ShortestPathTree shortestPathTree(const CsrGraph &graph, quint32 source)
+{
+    ShortestPathTree tree;
+    tree.distances.fill(INF, graph.nodeCount());
+    tree.parents.fill(CsrGraph::InvalidIndex, graph.nodeCount());
+
+    IndexedHeap heap;
+    heap.reserve(graph.nodeCount());
+    tree.distances[source] = 0.0;
+    heap.pushOrDecrease(source, 0.0);
+
+    while (!heap.isEmpty()) {
+        const quint32 current = heap.popMin();
+        tree.settleOrder.append(current);
+        const double distance = tree.distances[current];
+        for (quint32 arc = graph.arcBegin(current); arc < graph.arcEnd(current); ++arc) {
+            const quint32 next = graph.arcTarget(arc);
+            const double nextDistance = distance + graph.arcLength(arc);
+            if (nextDistance < tree.distances[next]) {
+                tree.distances[next] = nextDistance;
+                tree.parents[next] = current;
+                heap.pushOrDecrease(next, nextDistance);
+            }
+        }
+    }
+    return tree;
+}
+
+double tableLowerBound(const QVector<QVector<double>> &tables, quint32 a, quint32 b)
+{
+    double bound = 0.0;
+    for (const QVector<double> &table : tables) {
+        if (std::isinf(table[a]) || std::isinf(table[b])) {
+            continue;
+        }
+        bound = qMax(bound, std::abs(table[b] - table[a]));
+    }
+    return bound;
+}
+
+// Node furthest (by smallest distance) from every landmark chosen so far
+quint32 selectFarthest(const QVector<QVector<double>> &tables, quint32 nodeCount)
+{
+    quint32 best = 0;
+    double bestDistance = -1.0;
+    for (quint32 node = 0; node < nodeCount; ++node) {
+        double nearest = INF;
+        for (const QVector<double> &table : tables) {
+            nearest = qMin(nearest, table[node]);
+        }
+        if (std::isinf(nearest)) {
+            return node; // Part of the graph no landmark reaches yet
+        }
+        if (nearest > bestDistance) {
+            bestDistance = nearest;
+            best = node;
+        }
+    }
+    return best;
+}
+
+// Goldberg-Werneck "avoid": grow a shortest path tree from root, weight each
+// node by how badly the current landmarks bound its distance to root, and
+// descend into the heaviest landmark-free subtree down to a leaf.
+quint32 selectAvoid(const CsrGraph &graph, const QVector<QVector<double>> &tables,
+                    const QVector<quint32> &landmarks, quint32 root)
+{
+    const ShortestPathTree tree = shortestPathTree(graph, root);
+    const quint32 nodeCount = graph.nodeCount();
+
+    QVector<double> size(nodeCount, 0.0);
+    QVector<bool> holdsLandmark(nodeCount, false);
+    for (quint32 landmark : landmarks) {
+        holdsLandmark[landmark] = true;
+    }
+
+    // Reverse settle order visits children before their parents
+    for (int i = tree.settleOrder.size() - 1; i >= 0; --i) {
+        const quint32 node = tree.settleOrder[i];
+        if (!holdsLandmark[node]) {
+            size[node] += tree.distances[node] - tableLowerBound(tables, root, node);
+        }
+        const quint32 parent = tree.parents[node];
+        if (parent == CsrGraph::InvalidIndex) {
+            continue;
+        }
+        if (holdsLandmark[node]) {
+            holdsLandmark[parent] = true;
+        } else {
+            size[parent] += size[node];
+        }
+    }
+    for (quint32 node = 0; node < nodeCount; ++node) {
+        if (holdsLandmark[node]) {
+            size[node] = 0.0;
+        }
+    }
+    if (size[root] <= 0.0) {
+        return selectFarthest(tables, nodeCount);
+    }
+
+    QVector<QVector<quint32>> children(nodeCount);
+    for (quint32 node : tree.settleOrder) {
+        if (tree.parents[node] != CsrGraph::InvalidIndex) {
+            children[tree.parents[node]].append(node);
+        }
+    }
+
+    quint32 current = root;
+    while (true) {
+        quint32 heaviest = CsrGraph::InvalidIndex;
+        for (quint32 child : children[current]) {
+            if (size[child] > 0.0 && (heaviest == CsrGraph::InvalidIndex || size[child] > size[heaviest])) {
+                heaviest = child;
+            }
+        }
+        if (heaviest == CsrGraph::InvalidIndex) {
+            return current;
+        }
+        current = heaviest;
+    }
+}
+
+} // namespace
+
+void LandmarkSet::build(const CsrGraph &graph, int count, Selection selection)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    nodeCount = graph.nodeCount();
+    landmarks.clear();
+    distances.clear();
+    if (nodeCount == 0 || count <= 0) {
+        return;
+    }
+
+    // Seeded from the graph so repeated builds pick the same landmarks
+    QRandomGenerator rng(nodeCount);
+    QVector<QVector<double>> tables;
+
+    while (landmarks.size() < count && quint32(landmarks.size()) < nodeCount) {
+        quint32 next;
+        if (selection == Avoid) {
+            next = selectAvoid(graph, tables, landmarks, rng.bounded(nodeCount));
+        } else if (tables.isEmpty()) {
+            // Start from the node furthest from an arbitrary one
+            next = selectFarthest({shortestPathTree(graph, rng.bounded(nodeCount)).distances}, nodeCount);
+        } else {
+            next = selectFarthest(tables, nodeCount);
+        }
+        if (landmarks.contains(next)) {
+            break; // Every node is already bounded as well as it can be
+        }
+        landmarks.append(next);
+        tables.append(shortestPathTree(graph, next).distances);
+    }
+
+    const int landmarkCount = landmarks.size();
+    distances.resize(qsizetype(nodeCount) * landmarkCount);
+    for (quint32 node = 0; node < nodeCount; ++node) {
+        for (int l = 0; l < landmarkCount; ++l) {
+            distances[qsizetype(node) * landmarkCount + l] = tables[l][node];
+        }
+    }
+
+    qDebug() << "Selected" << landmarkCount << "landmarks in" << timer.elapsed() << "ms.";
+}
+
+double LandmarkSet::lowerBound(quint32 a, quint32 b) const
+{
+    const int landmarkCount = landmarks.size();
+    const double *fromA = distances.constData() + qsizetype(a) * landmarkCount;
+    const double *fromB = distances.constData() + qsizetype(b) * landmarkCount;
+
+    double bound = 0.0;
+    for (int l = 0; l < landmarkCount; ++l) {
+        // Different components give inf - x; such a landmark says nothing
+        const double difference = std::abs(fromB[l] - fromA[l]);
+        if (difference > bound && !std::isinf(difference) && !std::isnan(difference)) {
+            bound = difference;
+        }
+    }
+    return bound;
+}
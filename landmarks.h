@@ -0,0 +1,47 @@
+// landmarks.h
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include <QVector>
+#include "csrgraph.h"
+
+/**
+ * @brief The LandmarkSet class
+ * Landmarks and their distance tables for the ALT heuristic
+ * (A*, landmarks, triangle inequality).
+ *
+ * Distances are computed on open edge lengths. Blocking an edge can only
+ * make true distances longer, so the bounds stay admissible while obstacles
+ * come and go.
+ */
+class LandmarkSet {
+public:
+    enum Selection {
+        Farthest, // each new landmark maximises its distance to the chosen ones
+        Avoid     // grows into the region the current landmarks bound worst
+    };
+
+    LandmarkSet() = default;
+
+    void build(const CsrGraph &graph, int count, Selection selection = Avoid);
+
+    bool isEmpty() const { return landmarks.isEmpty(); }
+    int count() const { return landmarks.size(); }
+    quint32 landmark(int index) const { return landmarks[index]; }
+
+    /**
+     * @brief lowerBound
+     * Admissible lower bound on the distance between two dense nodes:
+     * max over landmarks L of |d(L, b) - d(L, a)|.
+     */
+    double lowerBound(quint32 a, quint32 b) const;
+
+private:
+    quint32 nodeCount = 0;
+    QVector<quint32> landmarks;
+    QVector<double> distances; // node-major: distances[node * count() + landmark]
+
+    friend class GraphSnapshot;
+};
+
+#endif // LANDMARKS_H
@@ -0,0 +1,61 @@
+// localprojection.h
+#ifndef LOCALPROJECTION_H
+#define LOCALPROJECTION_H
+
+#include <QGeoCoordinate>
+#include <QtMath>
+#include <cmath>
+
+/**
+ * @brief PlanePoint
+ * Position on the local tangent plane, in meters east (x) and north (y) of
+ * the projection origin.
+ */
+struct PlanePoint {
+    double x = 0.0;
+    double y = 0.0;
+};
+
+inline double planeDistance(const PlanePoint &a, const PlanePoint &b) {
+    return std::hypot(b.x - a.x, b.y - a.y);
+}
+
+/**
+ * @brief The LocalProjection class
+ * Equirectangular projection on the plane tangent at an origin, meant for
+ * areas a few kilometres wide: over such an area it stays within a fraction
+ * of a per mille of great-circle distances, and both directions are a
+ * multiply-add. Routing heuristics, vehicle kinematics and radio ranges work
+ * in these coordinates; latitude and longitude only come back for display.
+ */
+class LocalProjection {
+public:
+    // Sphere radius used by QGeoCoordinate::distanceTo()
+    static constexpr double EarthRadius = 6371007.2;
+
+    LocalProjection() = default;
+    LocalProjection(double originLatitude, double originLongitude)
+        : originLatitude(originLatitude),
+          originLongitude(originLongitude),
+          metresPerDegreeLatitude(EarthRadius * M_PI / 180.0),
+          metresPerDegreeLongitude(metresPerDegreeLatitude * std::cos(qDegreesToRadians(originLatitude))) {}
+
+    PlanePoint project(double latitude, double longitude) const {
+        return {(longitude - originLongitude) * metresPerDegreeLongitude,
+                (latitude - originLatitude) * metresPerDegreeLatitude};
+    }
+
+    double latitude(const PlanePoint &point) const { return originLatitude + point.y / metresPerDegreeLatitude; }
+    double longitude(const PlanePoint &point) const { return originLongitude + point.x / metresPerDegreeLongitude; }
+    QGeoCoordinate coordinate(const PlanePoint &point) const {
+        return QGeoCoordinate(latitude(point), longitude(point));
+    }
+
+private:
+    double originLatitude = 0.0;
+    double originLongitude = 0.0;
+    double metresPerDegreeLatitude = EarthRadius * M_PI / 180.0;
+    double metresPerDegreeLongitude = EarthRadius * M_PI / 180.0;
+};
+
+#endif // LOCALPROJECTION_H
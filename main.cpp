@@ -1,15 +1,28 @@
 // main.cpp
 #include "mainwindow.h"
+#include "graphsnapshot.h"
 #include "osmimporter.h"
 #include "simulationmanager.h"
+#include "vehiclelayer.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDir>
 #include <QEventLoop>
+#include <QStandardPaths>
 #include <QTimer>
+#include <QQmlEngine>
 #include <QDebug>
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption osmOption("osm", "Fichier .osm local à charger au lieu d'interroger Overpass.", "file");
+    parser.addOption(osmOption);
+    parser.process(app);
+
     Graph fullGraph;
     OSMImporter importer(fullGraph);
 
@@ -24,28 +37,75 @@ int main(int argc, char *argv[]) {
     double centerLon = (minLon + maxLon) / 2.0;
     int defaultZoomLevel = 14;
 
-    QEventLoop loop;
-    bool importSuccessful = false;
+    // The prepared graph is cached per source, so a known map skips the
+    // import, the simplification and the routing preprocessing
+    const QByteArray fingerprint = parser.isSet(osmOption)
+        ? GraphSnapshot::fileFingerprint(parser.value(osmOption))
+        : "overpass:" + bbox.toUtf8();
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    const QString snapshotPath = QDir(cacheDir).filePath(
+        QString::fromLatin1("graph-%1.snapshot")
+            .arg(QString::fromLatin1(QCryptographicHash::hash(fingerprint, QCryptographicHash::Sha1).toHex().left(16))));
+
+    Graph simplifiedGraph;
+    GraphSnapshot snapshot;
+    if (snapshot.read(simplifiedGraph, snapshotPath, fingerprint)) {
+        qDebug() << "Graphe chargé depuis le cache" << snapshotPath;
+    } else {
+        bool importSuccessful = false;
+
+        if (parser.isSet(osmOption)) {
+            importSuccessful = importer.importFile(parser.value(osmOption));
+        } else {
+            QEventLoop loop;
+
+            importer.importData(bbox);
 
-    importer.importData(bbox);
+            QObject::connect(&importer, &OSMImporter::finished, [&loop, &importSuccessful]() {
+                importSuccessful = true;
+                loop.quit();
+            });
 
-    QObject::connect(&importer, &OSMImporter::finished, [&loop, &importSuccessful]() {
-        importSuccessful = true;
-        loop.quit();
-    });
+            QTimer::singleShot(30000, &loop, &QEventLoop::quit); // Adjust timeout as needed
+            loop.exec();
+        }
 
-    QTimer::singleShot(30000, &loop, &QEventLoop::quit); // Adjust timeout as needed
-    loop.exec();
+        if (!importSuccessful || fullGraph.nodes.isEmpty() || fullGraph.getEdges().isEmpty()) {
+            qWarning() << "Erreur lors de l'import des données OSM";
+            return -1;
+        }
+
+        // After building the simplified graph
+        simplifiedGraph = fullGraph.createSimplifiedGraph();
+        qDebug() << "Simplified graph: " << simplifiedGraph.nodes.size()
+                 << "nodes," << simplifiedGraph.getEdges().size() << "edges.";
+
+        // Routing and simulation run on the contiguous CSR view
+        simplifiedGraph.freeze();
+        simplifiedGraph.buildContractionHierarchy();
+        // ALT bounds stay admissible as edges get blocked, so the A* fallback uses them
+        simplifiedGraph.buildLandmarks(16);
+
+        if (!QDir().mkpath(cacheDir) || !snapshot.write(simplifiedGraph, snapshotPath, fingerprint)) {
+            qWarning() << "Impossible d'écrire le cache du graphe:" << snapshot.errorString();
+        }
+    }
 
-    if (!importSuccessful || fullGraph.nodes.isEmpty() || fullGraph.getEdges().isEmpty()) {
-        qWarning() << "Erreur lors de l'import des données OSM";
-        return -1;
+    if (parser.isSet(osmOption)) {
+        // Offline: no network, centre the map on the imported area
+        double south = 90.0, west = 180.0, north = -90.0, east = -180.0;
+        for (const Node *node : std::as_const(simplifiedGraph.nodes)) {
+            south = qMin(south, node->latitude);
+            north = qMax(north, node->latitude);
+            west = qMin(west, node->longitude);
+            east = qMax(east, node->longitude);
+        }
+        centerLat = (south + north) / 2.0;
+        centerLon = (west + east) / 2.0;
     }
 
-    // After building the simplified graph
-    Graph simplifiedGraph = fullGraph.createSimplifiedGraph();
-    qDebug() << "Simplified graph: " << simplifiedGraph.nodes.size()
-             << "nodes," << simplifiedGraph.getEdges().size() << "edges.";
+    // Vehicles are drawn by a C++ item rather than one QML delegate each
+    qmlRegisterType<VehicleLayer>("ProjetReseau", 1, 0, "VehicleLayer");
 
     // Initialize MainWindow with the simplified graph
     MainWindow w(&simplifiedGraph, centerLat, centerLon, defaultZoomLevel);
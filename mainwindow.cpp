@@ -32,11 +32,11 @@ MainWindow::MainWindow(Graph *graph, double centerLat, double centerLon, int zoo
 
     // Generate initial vehicles
     for (int i = 0; i < 40; ++i) {
-        if (graph->nodes.isEmpty()) {
+        if (graph->nodeCount() == 0) {
             qWarning() << "Graph is empty; cannot add vehicle" << i;
             continue;
         }
-        qint64 startNodeId = graph->nodes.keys().at(QRandomGenerator::global()->bounded(graph->nodes.size()));
+        qint64 startNodeId = graph->nodeIdAt(QRandomGenerator::global()->bounded(graph->nodeCount()));
         simManager->addVehicle(i, startNodeId);
     }
 
@@ -196,7 +196,7 @@ void MainWindow::resetSimulation() {
         qDebug() << "Début de la réinitialisation de la simulation...";
 
         // Verify graph
-        if (simManager->getGraph().nodes.isEmpty()) {
+        if (simManager->getGraph().nodeCount() == 0) {
             qCritical() << "Le graphe est vide. Impossible de relancer la simulation.";
             return;
         }
@@ -207,12 +207,12 @@ void MainWindow::resetSimulation() {
         // Add new vehicles
         int numVehicles = vehicleCountSpinBox->value();
         for (int i = 0; i < numVehicles; ++i) {
-            if (simManager->getGraph().nodes.isEmpty()) {
+            if (simManager->getGraph().nodeCount() == 0) {
                 qWarning() << "Graph is empty; cannot add vehicle" << i;
                 continue;
             }
-            qint64 startNodeId = simManager->getGraph().nodes.keys().at(
-                QRandomGenerator::global()->bounded(simManager->getGraph().nodes.size()));
+            qint64 startNodeId = simManager->getGraph().nodeIdAt(
+                QRandomGenerator::global()->bounded(simManager->getGraph().nodeCount()));
             simManager->addVehicle(i, startNodeId);
         }
 
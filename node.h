@@ -6,10 +6,13 @@
 class Node {
 public:
     qint64 id;
-    QGeoCoordinate coordinate;
+    double latitude;
+    double longitude;
 
-    Node(qint64 id, const QGeoCoordinate &coordinate)
-        : id(id), coordinate(coordinate) {}
+    Node(qint64 id, double latitude, double longitude)
+        : id(id), latitude(latitude), longitude(longitude) {}
+
+    QGeoCoordinate coordinate() const { return QGeoCoordinate(latitude, longitude); }
 };
 
 #endif // NODE_H
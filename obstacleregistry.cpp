@@ -0,0 +1,92 @@
+// obstacleregistry.cpp
+#include "obstacleregistry.h"
+#include <QDebug>
+
+ObstacleRegistry::ObstacleRegistry(Graph &graph, QObject *parent)
+    : QObject(parent), graph(graph)
+{
+    if (!graph.isFrozen()) {
+        qWarning() << "ObstacleRegistry needs a frozen graph; no edge can be blocked";
+        return;
+    }
+
+    const CsrGraph &csrGraph = graph.csr();
+    const quint32 edgeCount = csrGraph.edgeCount();
+    openSlots.fill(Blocked, int(edgeCount));
+    open.reserve(int(edgeCount));
+    expiries.reserve(edgeCount);
+    for (quint32 edge = 0; edge < edgeCount; ++edge) {
+        if (!csrGraph.blocked().test(edge)) {
+            openSlots[edge] = quint32(open.size());
+            open.append(edge);
+        }
+    }
+}
+
+void ObstacleRegistry::adoptBlockedEdges(double now, double lifetime)
+{
+    for (quint32 edge = 0; edge < quint32(openSlots.size()); ++edge) {
+        if (openSlots[edge] == Blocked && !expiries.contains(edge)) {
+            expiries.pushOrDecrease(edge, now + lifetime);
+            emit edgeBlocked(edge, now);
+        }
+    }
+}
+
+quint32 ObstacleRegistry::blockRandom(QRandomGenerator &random, double now, double lifetime)
+{
+    if (open.isEmpty()) {
+        return CsrGraph::InvalidIndex;
+    }
+    const quint32 edge = open[random.bounded(int(open.size()))];
+    block(edge, now, now + lifetime);
+    return edge;
+}
+
+bool ObstacleRegistry::block(quint32 edge, double now, double expiresAt)
+{
+    if (edge >= quint32(openSlots.size()) || openSlots[edge] == Blocked) {
+        return false;
+    }
+
+    // Swap-remove: the last open edge takes the freed slot
+    const quint32 slot = openSlots[edge];
+    const quint32 last = open.takeLast();
+    if (last != edge) {
+        open[slot] = last;
+        openSlots[last] = slot;
+    }
+    openSlots[edge] = Blocked;
+
+    expiries.pushOrDecrease(edge, expiresAt);
+    setBlocked(edge, true);
+    emit edgeBlocked(edge, now);
+    return true;
+}
+
+int ObstacleRegistry::expire(double now)
+{
+    int expired = 0;
+    while (!expiries.isEmpty() && expiries.minKey() <= now) {
+        const quint32 edge = expiries.popMin();
+        openSlots[edge] = quint32(open.size());
+        open.append(edge);
+        setBlocked(edge, false);
+        emit edgeUnblocked(edge);
+        expired++;
+    }
+    return expired;
+}
+
+void ObstacleRegistry::setBlocked(quint32 edge, bool blocked)
+{
+    // The graph keeps Edge::blocked, the CSR bit and the route cache in step
+    const CsrGraph &csrGraph = graph.csr();
+    const qint64 startId = csrGraph.osmId(csrGraph.edgeSource(edge));
+    const qint64 endId = csrGraph.osmId(csrGraph.edgeTarget(edge));
+    if (blocked) {
+        graph.blockEdge(startId, endId);
+    } else {
+        graph.unblockEdge(startId, endId);
+    }
+}
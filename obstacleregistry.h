@@ -0,0 +1,73 @@
+// obstacleregistry.h
+#ifndef OBSTACLEREGISTRY_H
+#define OBSTACLEREGISTRY_H
+
+#include <QObject>
+#include <QRandomGenerator>
+#include <QVector>
+#include "graph.h"
+#include "searchworkspace.h"
+
+/**
+ * @brief The ObstacleRegistry class
+ * Owns the timed obstacles of a simulation on a frozen graph.
+ *
+ * The open edges are kept as an unordered array of edge ids with each edge's
+ * slot in it, so a random open edge is picked and removed in O(1) by
+ * swapping it with the last one. Blocked edges wait in a min-heap keyed by
+ * their expiry time, so expire() only looks at the edges that are due.
+ * Every change is blocked or unblocked in the graph first, then announced
+ * by edgeBlocked() or edgeUnblocked(); views follow these signals only.
+ */
+class ObstacleRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ObstacleRegistry(Graph &graph, QObject *parent = nullptr);
+
+    const Graph &getGraph() const { return graph; }
+
+    int openCount() const { return int(open.size()); }
+    int blockedCount() const { return expiries.size(); }
+    bool isBlocked(quint32 edge) const { return openSlots[edge] == Blocked; }
+
+    /**
+     * @brief adoptBlockedEdges
+     * Schedules the edges already blocked in the graph to expire after
+     * lifetime, and announces them as blocked at now.
+     */
+    void adoptBlockedEdges(double now, double lifetime);
+
+    /**
+     * @brief blockRandom
+     * Blocks an open edge picked uniformly for lifetime simulated seconds.
+     * Returns the edge, or CsrGraph::InvalidIndex if every edge is blocked.
+     */
+    quint32 blockRandom(QRandomGenerator &random, double now, double lifetime);
+
+    // Blocks an open edge until expiresAt; false if it is already blocked
+    bool block(quint32 edge, double now, double expiresAt);
+
+    /**
+     * @brief expire
+     * Unblocks every edge whose expiry is not after now; returns how many.
+     */
+    int expire(double now);
+
+signals:
+    void edgeBlocked(quint32 edge, double blockedAt);
+    void edgeUnblocked(quint32 edge);
+
+private:
+    static constexpr quint32 Blocked = 0xFFFFFFFFu;
+
+    void setBlocked(quint32 edge, bool blocked);
+
+    Graph &graph;
+    QVector<quint32> open;       // Open edge ids, in no particular order
+    QVector<quint32> openSlots;  // Index in open per edge, Blocked otherwise
+    IndexedHeap expiries;        // Blocked edges by expiry time
+};
+
+#endif // OBSTACLEREGISTRY_H
@@ -1,4 +1,5 @@
 #include "osmimporter.h"
+#include "osmparser.h"
 #include <QXmlStreamReader>
 #include <QDebug>
 
@@ -32,6 +33,22 @@ void OSMImporter::importData(const QString &bbox)
     networkManager.post(request, queryData);
 }
 
+bool OSMImporter::importFile(const QString &path)
+{
+    OSMParser parser(graph);
+    const bool ok = parser.parseFile(path);
+    if (!ok) {
+        qWarning() << "Erreur durant l'import du fichier" << path << ":"
+                   << parser.errorString();
+    } else {
+        qDebug() << "Succès de l'import avec"
+                 << graph.nodes.size() << "nodes et"
+                 << graph.getEdges().size() << "edges.";
+    }
+    emit finished();
+    return ok;
+}
+
 void OSMImporter::handleNetworkReply(QNetworkReply *reply)
 {
     if (reply->error() != QNetworkReply::NoError) {
@@ -41,13 +58,13 @@ void OSMImporter::handleNetworkReply(QNetworkReply *reply)
         return;
     }
 
-    QByteArray data = reply->readAll();
-    QXmlStreamReader xml(data);
-    parseXml(xml);
+    // Parse straight from the reply's buffer instead of copying it out first
+    QXmlStreamReader xml(reply);
+    OSMParser parser(graph);
 
-    if (xml.hasError()) {
+    if (!parser.parse(xml)) {
         qWarning() << "Erreur XML durant l'import des données OSM:"
-                   << xml.errorString();
+                   << parser.errorString();
     } else {
         qDebug() << "Succès de l'import avec"
                  << graph.nodes.size() << "nodes et"
@@ -57,60 +74,3 @@ void OSMImporter::handleNetworkReply(QNetworkReply *reply)
     reply->deleteLater();
     emit finished();
 }
-
-void OSMImporter::parseXml(QXmlStreamReader &xml)
-{
-    QMap<qint64, Node*> parsedNodes;
-
-    while (!xml.atEnd() && !xml.hasError()) {
-        xml.readNext();
-        if (xml.tokenType() == QXmlStreamReader::StartElement) {
-            if (xml.name() == "node") {
-                qint64 id = xml.attributes().value("id").toLongLong();
-                double lat = xml.attributes().value("lat").toDouble();
-                double lon = xml.attributes().value("lon").toDouble();
-                QGeoCoordinate coord(lat, lon);
-                Node *node = new Node(id, coord);
-                parsedNodes.insert(id, node);
-                graph.addNode(id, coord);
-
-            } else if (xml.name() == "way") {
-                QList<Node*> wayNodes;
-
-                while (!(xml.tokenType() == QXmlStreamReader::EndElement
-                         && xml.name() == "way"))
-                {
-                    if (xml.tokenType() == QXmlStreamReader::StartElement
-                        && xml.name() == "nd")
-                    {
-                        qint64 ref = xml.attributes().value("ref").toLongLong();
-                        if (parsedNodes.contains(ref)) {
-                            wayNodes.append(parsedNodes[ref]);
-                        }
-                    }
-                    xml.readNext();
-                }
-
-                // Add bidirectional edges between successive node pairs
-                for (int i = 0; i < wayNodes.size() - 1; ++i) {
-                    Node *start = wayNodes[i];
-                    Node *end   = wayNodes[i + 1];
-
-                    // **Skip adding edge if start and end nodes are the same**
-                    if (start->id == end->id) {
-                        qDebug() << "Skipping duplicate edge between node" << start->id;
-                        continue;
-                    }
-
-                    double length = start->coordinate.distanceTo(end->coordinate);
-                    graph.addEdge(start->id, end->id, length);
-                }
-            }
-        }
-    }
-
-    if (xml.hasError()) {
-        qWarning() << "Erreur pendant le parsing du XML:"
-                   << xml.errorString();
-    }
-}
@@ -4,7 +4,6 @@
 #include <QObject>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
-#include <QXmlStreamReader>
 #include "graph.h"
 
 class OSMImporter : public QObject {
@@ -14,6 +13,13 @@ public:
     explicit OSMImporter(Graph &graph, QObject *parent = nullptr);
     void importData(const QString &bbox);
 
+    /**
+     * @brief importFile
+     * Offline import of a local .osm file, streamed from disk. Emits
+     * finished() like importData() and returns false on error.
+     */
+    bool importFile(const QString &path);
+
 signals:
     void finished();  // Signal indicating the import is finished
 
@@ -23,7 +29,6 @@ private slots:
 private:
     Graph &graph;
     QNetworkAccessManager networkManager;
-    void parseXml(QXmlStreamReader &xml);
 };
 
 #endif // OSMIMPORTER_H
@@ -0,0 +1,181 @@
+#include "osmparser.h"
+#include "osmpbfreader.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDebug>
+
+OSMParser::OSMParser(Graph &graph)
+    : graph(graph)
+{
+}
+
+bool OSMParser::parseFile(const QString &path)
+{
+    if (path.endsWith(QLatin1String(".pbf"), Qt::CaseInsensitive)) {
+        return parsePbf(path);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        qWarning() << "Impossible d'ouvrir" << path << ":" << error;
+        return false;
+    }
+
+    // The reader pulls from the file as it goes; the document is never in memory
+    QXmlStreamReader xml(&file);
+    return parse(xml);
+}
+
+bool OSMParser::parse(QXmlStreamReader &xml)
+{
+    QElapsedTimer timer;
+    timer.start();
+    nodeCount = 0;
+    wayCount = 0;
+    roadCount = 0;
+
+    while (!xml.atEnd() && !xml.hasError()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        if (xml.name() == QLatin1String("node")) {
+            const QXmlStreamAttributes attributes = xml.attributes();
+            const qint64 id = attributes.value("id").toLongLong();
+            coordinates.insert(id, {attributes.value("lat").toDouble(),
+                                    attributes.value("lon").toDouble()});
+            nodeCount++;
+        } else if (xml.name() == QLatin1String("way")) {
+            readWay(xml);
+        }
+    }
+
+    elapsed = timer.elapsed();
+    coordinates.clear();
+
+    if (xml.hasError()) {
+        error = xml.errorString();
+        qWarning() << "Erreur pendant le parsing du XML:"
+                   << error;
+        return false;
+    }
+
+    finish(QStringLiteral("XML"));
+    return true;
+}
+
+bool OSMParser::parsePbf(const QString &path)
+{
+    QElapsedTimer timer;
+    timer.start();
+    nodeCount = 0;
+    wayCount = 0;
+    roadCount = 0;
+
+    OSMPbfReader reader;
+    if (threads > 0) {
+        reader.setThreadCount(threads);
+    }
+    // Blocks arrive in file order: nodes first, then the ways using them
+    const bool ok = reader.read(path, [this](const OSMPbfBlock &block) {
+        coordinates.reserve(coordinates.size() + block.nodeIds.size());
+        for (qsizetype i = 0; i < block.nodeIds.size(); ++i) {
+            coordinates.insert(block.nodeIds[i], {block.latitudes[i], block.longitudes[i]});
+        }
+        nodeCount += block.nodeIds.size();
+        wayCount += block.wayCount;
+        for (const QVector<qint64> &refs : block.highways) {
+            roadCount++;
+            addRoad(refs);
+        }
+    });
+
+    elapsed = timer.elapsed();
+    coordinates.clear();
+
+    if (!ok) {
+        error = reader.errorString();
+        qWarning() << "Erreur pendant la lecture du PBF:" << error;
+        return false;
+    }
+
+    finish(QStringLiteral("PBF"));
+    return true;
+}
+
+void OSMParser::finish(const QString &format)
+{
+    qDebug() << "Import OSM" << format << ":" << nodeCount << "nœuds," << wayCount << "ways ("
+             << roadCount << "routes) en" << elapsed << "ms,"
+             << qRound64(nodesPerSecond()) << "nœuds/s";
+}
+
+void OSMParser::readWay(QXmlStreamReader &xml)
+{
+    wayCount++;
+    wayRefs.clear();
+    bool highway = false;
+
+    // Node references come before the tags, so keep them until </way>
+    while (!xml.atEnd() && !xml.hasError()) {
+        const QXmlStreamReader::TokenType token = xml.readNext();
+        if (token == QXmlStreamReader::EndElement && xml.name() == QLatin1String("way")) {
+            break;
+        }
+        if (token != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        if (xml.name() == QLatin1String("nd")) {
+            wayRefs.append(xml.attributes().value("ref").toLongLong());
+        } else if (xml.name() == QLatin1String("tag")
+                   && xml.attributes().value("k") == QLatin1String("highway")) {
+            highway = true;
+        }
+    }
+
+    // Same filter as the Overpass query: roads only
+    if (!highway) {
+        return;
+    }
+    roadCount++;
+    addRoad(wayRefs);
+}
+
+template <typename Refs>
+void OSMParser::addRoad(const Refs &refs)
+{
+    // Add bidirectional edges between successive node pairs. Node ids may be
+    // negative (objects created in JOSM), so no id can mark "no previous node".
+    qint64 previous = 0;
+    bool hasPrevious = false;
+    for (qint64 current : refs) {
+        if (!addRoadNode(current)) {
+            hasPrevious = false; // Node outside the extract: the way is cut here
+            continue;
+        }
+        if (hasPrevious) {
+            // Skip adding edge if start and end nodes are the same
+            if (previous == current) {
+                qDebug() << "Skipping duplicate edge between node" << current;
+                continue;
+            }
+            const double length = graph.coordinate(previous).distanceTo(graph.coordinate(current));
+            graph.addEdge(previous, current, length);
+        }
+        previous = current;
+        hasPrevious = true;
+    }
+}
+
+bool OSMParser::addRoadNode(qint64 ref)
+{
+    if (graph.hasNode(ref)) {
+        return true;
+    }
+    const auto it = coordinates.constFind(ref);
+    if (it == coordinates.constEnd()) {
+        return false;
+    }
+    graph.addNode(ref, it->lat, it->lon);
+    return true;
+}
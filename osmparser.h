@@ -0,0 +1,72 @@
+#ifndef OSMPARSER_H
+#define OSMPARSER_H
+
+#include <QString>
+#include <QHash>
+#include <QXmlStreamReader>
+#include "graph.h"
+
+/**
+ * @brief The OSMParser class
+ * Fills a Graph from OSM XML: the ways tagged highway and the nodes they
+ * use. Needs only QtCore, so the headless runner can load maps without the
+ * network stack.
+ *
+ * The document is streamed token by token. Node coordinates are held in a
+ * plain table until a way uses them, so a node that no road references never
+ * reaches the graph and no Node object is created twice. Files ending in
+ * .pbf go through OSMPbfReader instead, with the same filtering.
+ */
+class OSMParser {
+public:
+    explicit OSMParser(Graph &graph);
+
+    /**
+     * @brief parse
+     * Reads the whole document; returns false on an XML error.
+     */
+    bool parse(QXmlStreamReader &xml);
+
+    /**
+     * @brief parseFile
+     * Streams an .osm file saved from Overpass or an OSM extract, or reads
+     * an .osm.pbf extract with its blocks decoded on threadCount threads.
+     */
+    bool parseFile(const QString &path);
+    void setThreadCount(int count) { threads = count; }
+
+    QString errorString() const { return error; }
+
+    // Statistics of the last parse
+    qint64 nodesRead() const { return nodeCount; }
+    qint64 waysRead() const { return wayCount; }
+    qint64 roadsKept() const { return roadCount; }
+    qint64 elapsedMs() const { return elapsed; }
+    double nodesPerSecond() const { return elapsed > 0 ? nodeCount * 1000.0 / elapsed : 0.0; }
+
+private:
+    struct Coordinate {
+        double lat;
+        double lon;
+    };
+
+    bool parsePbf(const QString &path);
+    void readWay(QXmlStreamReader &xml);
+    template <typename Refs>
+    void addRoad(const Refs &refs);
+    bool addRoadNode(qint64 ref); // Adds ref to the graph; false if outside the extract
+    void finish(const QString &format);
+
+    Graph &graph;
+    QString error;
+    QHash<qint64, Coordinate> coordinates; // Every <node> seen so far
+    QList<qint64> wayRefs;                 // Reused across ways
+
+    qint64 nodeCount = 0;
+    qint64 wayCount = 0;
+    qint64 roadCount = 0;
+    qint64 elapsed = 0;
+    int threads = 0; // 0: all cores
+};
+
+#endif // OSMPARSER_H
@@ -0,0 +1,432 @@
+#include "osmpbfreader.h"
+#include <QFile>
+#include <QtEndian>
+#include <cstring>
+#include <QDebug>
+
+static const int BLOBS_PER_THREAD = 4;              // Per decoding batch
+static const qint32 MAX_BLOB_HEADER_SIZE = 64 * 1024; // Limits from the format specification
+static const qint32 MAX_BLOB_SIZE = 32 * 1024 * 1024;
+
+namespace {
+
+// Just enough protobuf to walk OSM messages: varints, zigzag, length-delimited
+// fields and packed repeated scalars. Unknown fields are skipped.
+class ProtoReader {
+public:
+    enum WireType { Varint = 0, Fixed64 = 1, LengthDelimited = 2, Fixed32 = 5 };
+
+    ProtoReader(const char *data, qsizetype size)
+        : p(reinterpret_cast<const uchar *>(data)), end(p + size) {}
+    explicit ProtoReader(const QByteArray &data) : ProtoReader(data.constData(), data.size()) {}
+
+    bool atEnd() const { return p >= end || failed; }
+    bool hasError() const { return failed; }
+
+    // Reads the next key; false at the end of the message
+    bool next()
+    {
+        if (atEnd()) {
+            return false;
+        }
+        const quint64 key = varint();
+        fieldNumber = int(key >> 3);
+        wireType = int(key & 7);
+        return !failed;
+    }
+    int field() const { return fieldNumber; }
+
+    quint64 varint()
+    {
+        quint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) {
+                break;
+            }
+            const uchar byte = *p++;
+            value |= quint64(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    qint64 svarint()
+    {
+        const quint64 value = varint();
+        return qint64(value >> 1) ^ -qint64(value & 1);
+    }
+
+    ProtoReader message()
+    {
+        const quint64 size = varint();
+        if (failed || size > quint64(end - p)) {
+            failed = true;
+            return ProtoReader(nullptr, 0);
+        }
+        ProtoReader nested(reinterpret_cast<const char *>(p), qsizetype(size));
+        p += size;
+        return nested;
+    }
+
+    QByteArray bytes()
+    {
+        const ProtoReader nested = message();
+        return QByteArray(reinterpret_cast<const char *>(nested.p), nested.end - nested.p);
+    }
+
+    void skip()
+    {
+        switch (wireType) {
+        case Varint: varint(); break;
+        case Fixed64: advance(8); break;
+        case LengthDelimited: message(); break;
+        case Fixed32: advance(4); break;
+        default: failed = true; break;
+        }
+    }
+
+private:
+    void advance(qsizetype count)
+    {
+        if (count > end - p) {
+            failed = true;
+        } else {
+            p += count;
+        }
+    }
+
+    const uchar *p;
+    const uchar *end;
+    int fieldNumber = 0;
+    int wireType = 0;
+    bool failed = false;
+};
+
+// Blob { raw = 1; raw_size = 2; zlib_data = 3; ... }
+bool inflateBlob(const QByteArray &blob, QByteArray &out, QString &error)
+{
+    ProtoReader reader(blob);
+    QByteArray zlib;
+    quint32 rawSize = 0;
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 1: out = reader.bytes(); return true;
+        case 2: rawSize = quint32(reader.varint()); break;
+        case 3: zlib = reader.bytes(); break;
+        case 4: case 5: case 6: case 7:
+            error = QStringLiteral("compression non supportée (champ %1)").arg(reader.field());
+            return false;
+        default: reader.skip(); break;
+        }
+    }
+    if (reader.hasError() || zlib.isEmpty()) {
+        error = QStringLiteral("blob corrompu");
+        return false;
+    }
+
+    // qUncompress wants the expected size as a big-endian prefix
+    QByteArray input(4 + zlib.size(), Qt::Uninitialized);
+    qToBigEndian(rawSize, input.data());
+    memcpy(input.data() + 4, zlib.constData(), size_t(zlib.size()));
+    out = qUncompress(input);
+    if (out.size() != qsizetype(rawSize)) {
+        error = QStringLiteral("décompression zlib impossible");
+        return false;
+    }
+    return true;
+}
+
+// DenseNodes { id = 1 (packed, delta); lat = 8; lon = 9 (packed, delta) }
+void decodeDenseNodes(ProtoReader reader, double granularity, double latOffset, double lonOffset,
+                      OSMPbfBlock &block)
+{
+    const qsizetype first = block.nodeIds.size();
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 1: {
+            ProtoReader packed = reader.message();
+            qint64 id = 0;
+            while (!packed.atEnd()) {
+                id += packed.svarint();
+                block.nodeIds.append(id);
+            }
+            break;
+        }
+        case 8: case 9: {
+            QVector<double> &target = reader.field() == 8 ? block.latitudes : block.longitudes;
+            const double offset = reader.field() == 8 ? latOffset : lonOffset;
+            ProtoReader packed = reader.message();
+            qint64 value = 0;
+            while (!packed.atEnd()) {
+                value += packed.svarint();
+                target.append(1e-9 * (offset + granularity * double(value)));
+            }
+            break;
+        }
+        default:
+            reader.skip();
+            break;
+        }
+    }
+    const qsizetype count = block.nodeIds.size() - first;
+    if (block.latitudes.size() - first != count || block.longitudes.size() - first != count) {
+        block.error = QStringLiteral("DenseNodes incohérents");
+    }
+}
+
+// Node { id = 1 (sint64); lat = 8; lon = 9 (sint64) }
+void decodeNode(ProtoReader reader, double granularity, double latOffset, double lonOffset,
+                OSMPbfBlock &block)
+{
+    qint64 id = 0, lat = 0, lon = 0;
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 1: id = reader.svarint(); break;
+        case 8: lat = reader.svarint(); break;
+        case 9: lon = reader.svarint(); break;
+        default: reader.skip(); break;
+        }
+    }
+    block.nodeIds.append(id);
+    block.latitudes.append(1e-9 * (latOffset + granularity * double(lat)));
+    block.longitudes.append(1e-9 * (lonOffset + granularity * double(lon)));
+}
+
+// Way { id = 1; keys = 2 (packed string indices); refs = 8 (packed, delta) }
+void decodeWay(ProtoReader reader, quint32 highwayKey, OSMPbfBlock &block)
+{
+    bool highway = false;
+    QVector<qint64> refs;
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 2: {
+            ProtoReader packed = reader.message();
+            while (!packed.atEnd()) {
+                if (quint32(packed.varint()) == highwayKey) {
+                    highway = true;
+                }
+            }
+            break;
+        }
+        case 8: {
+            ProtoReader packed = reader.message();
+            qint64 ref = 0;
+            while (!packed.atEnd()) {
+                ref += packed.svarint();
+                refs.append(ref);
+            }
+            break;
+        }
+        default:
+            reader.skip();
+            break;
+        }
+    }
+    block.wayCount++;
+    if (highway) {
+        block.highways.append(refs);
+    }
+}
+
+// PrimitiveBlock { stringtable = 1; primitivegroup = 2; granularity = 17;
+//                  lat_offset = 19; lon_offset = 20 }
+void decodePrimitiveBlock(const QByteArray &data, OSMPbfBlock &block)
+{
+    // The scalars may follow the groups, so find them first
+    ProtoReader reader(data);
+    quint32 highwayKey = quint32(-1);
+    double granularity = 100.0, latOffset = 0.0, lonOffset = 0.0;
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 1: {
+            ProtoReader strings = reader.message();
+            quint32 index = 0;
+            while (strings.next()) {
+                if (strings.field() != 1) {
+                    strings.skip();
+                    continue;
+                }
+                if (strings.bytes() == "highway") {
+                    highwayKey = index;
+                }
+                index++;
+            }
+            break;
+        }
+        case 17: granularity = double(reader.varint()); break;
+        case 19: latOffset = double(qint64(reader.varint())); break;
+        case 20: lonOffset = double(qint64(reader.varint())); break;
+        default: reader.skip(); break;
+        }
+    }
+
+    reader = ProtoReader(data);
+    while (reader.next()) {
+        if (reader.field() != 2) {
+            reader.skip();
+            continue;
+        }
+        // PrimitiveGroup { nodes = 1; dense = 2; ways = 3; relations = 4 }
+        ProtoReader group = reader.message();
+        while (group.next()) {
+            switch (group.field()) {
+            case 1: decodeNode(group.message(), granularity, latOffset, lonOffset, block); break;
+            case 2: decodeDenseNodes(group.message(), granularity, latOffset, lonOffset, block); break;
+            case 3: decodeWay(group.message(), highwayKey, block); break;
+            default: group.skip(); break;
+            }
+        }
+        if (group.hasError()) {
+            block.error = QStringLiteral("PrimitiveGroup corrompu");
+            return;
+        }
+    }
+    if (reader.hasError()) {
+        block.error = QStringLiteral("PrimitiveBlock corrompu");
+    }
+}
+
+} // namespace
+
+OSMPbfReader::OSMPbfReader()
+{
+}
+
+bool OSMPbfReader::readBlob(QFile &file, Blob &blob)
+{
+    // [int32 big-endian size][BlobHeader][Blob]
+    char sizeBytes[4];
+    if (file.read(sizeBytes, 4) != 4) {
+        error = QStringLiteral("en-tête de blob tronqué");
+        return false;
+    }
+    const qint32 headerSize = qFromBigEndian<qint32>(sizeBytes);
+    if (headerSize <= 0 || headerSize > MAX_BLOB_HEADER_SIZE) {
+        error = QStringLiteral("taille d'en-tête de blob invalide");
+        return false;
+    }
+    const QByteArray header = file.read(headerSize);
+    if (header.size() != headerSize) {
+        error = QStringLiteral("en-tête de blob tronqué");
+        return false;
+    }
+
+    // BlobHeader { type = 1; indexdata = 2; datasize = 3 }
+    ProtoReader reader(header);
+    qint64 dataSize = -1;
+    blob.type.clear();
+    while (reader.next()) {
+        switch (reader.field()) {
+        case 1: blob.type = reader.bytes(); break;
+        case 3: dataSize = qint64(reader.varint()); break;
+        default: reader.skip(); break;
+        }
+    }
+    if (reader.hasError() || dataSize < 0 || dataSize > MAX_BLOB_SIZE) {
+        error = QStringLiteral("BlobHeader invalide");
+        return false;
+    }
+    blob.data = file.read(dataSize);
+    if (blob.data.size() != dataSize) {
+        error = QStringLiteral("blob tronqué");
+        return false;
+    }
+    return true;
+}
+
+bool OSMPbfReader::checkHeader(const QByteArray &data)
+{
+    // HeaderBlock { required_features = 4 }
+    static const QList<QByteArray> supported = {"OsmSchema-V0.6", "DenseNodes"};
+    ProtoReader reader(data);
+    while (reader.next()) {
+        if (reader.field() != 4) {
+            reader.skip();
+            continue;
+        }
+        const QByteArray feature = reader.bytes();
+        if (!supported.contains(feature)) {
+            error = QStringLiteral("fonctionnalité PBF requise non supportée : %1").arg(QString::fromUtf8(feature));
+            return false;
+        }
+    }
+    if (reader.hasError()) {
+        error = QStringLiteral("HeaderBlock corrompu");
+        return false;
+    }
+    return true;
+}
+
+bool OSMPbfReader::read(const QString &path, const std::function<void(const OSMPbfBlock &)> &consume)
+{
+    error.clear();
+    blocks = 0;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    bool headerSeen = false;
+    const int batchSize = qMax(1, pool.maxThreadCount()) * BLOBS_PER_THREAD;
+    QVector<QByteArray> batch;
+    QVector<OSMPbfBlock> decoded;
+
+    while (!file.atEnd()) {
+        // Read a batch of blobs serially; the file is the only shared resource
+        batch.clear();
+        while (batch.size() < batchSize && !file.atEnd()) {
+            Blob blob;
+            if (!readBlob(file, blob)) {
+                return false;
+            }
+            if (blob.type == "OSMHeader") {
+                QByteArray data;
+                if (!inflateBlob(blob.data, data, error) || !checkHeader(data)) {
+                    return false;
+                }
+                headerSeen = true;
+            } else if (blob.type == "OSMData") {
+                if (!headerSeen) {
+                    error = QStringLiteral("OSMData avant OSMHeader");
+                    return false;
+                }
+                batch.append(blob.data);
+            } // Unknown blob types are skipped, as the format allows
+        }
+
+        // Inflate and decode the batch in parallel
+        decoded = QVector<OSMPbfBlock>(batch.size());
+        for (int i = 0; i < batch.size(); ++i) {
+            const QByteArray *blob = &batch[i];
+            OSMPbfBlock *block = &decoded[i];
+            pool.start([blob, block]() {
+                QByteArray data;
+                if (inflateBlob(*blob, data, block->error)) {
+                    decodePrimitiveBlock(data, *block);
+                }
+            });
+        }
+        pool.waitForDone();
+
+        // Hand the blocks over in file order
+        for (const OSMPbfBlock &block : std::as_const(decoded)) {
+            if (!block.error.isEmpty()) {
+                error = block.error;
+                return false;
+            }
+            consume(block);
+            blocks++;
+        }
+    }
+
+    if (!headerSeen) {
+        error = QStringLiteral("fichier PBF vide ou sans OSMHeader");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef OSMPBFREADER_H
+#define OSMPBFREADER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+
+class QFile;
+
+/**
+ * @brief OSMPbfBlock
+ * What one OSMData blob holds that the importer needs: every node with its
+ * coordinate, and the node references of the ways tagged highway.
+ */
+struct OSMPbfBlock {
+    QVector<qint64> nodeIds;
+    QVector<double> latitudes;
+    QVector<double> longitudes;
+    QList<QVector<qint64>> highways;
+    qint64 wayCount = 0;
+    QString error;
+};
+
+/**
+ * @brief The OSMPbfReader class
+ * Reader for .osm.pbf extracts, with its own minimal protobuf decoder.
+ *
+ * Blobs are read from the file in order and inflated and decoded in
+ * batches on a worker pool; each decoded block is then handed to consume()
+ * on the calling thread in file order. At most a few batches of blocks are
+ * in memory at a time. Only zlib and uncompressed blobs are supported, which
+ * covers the extracts published by Geofabrik and planet.osm.
+ */
+class OSMPbfReader {
+public:
+    OSMPbfReader();
+
+    void setThreadCount(int count) { pool.setMaxThreadCount(qMax(1, count)); }
+
+    bool read(const QString &path, const std::function<void(const OSMPbfBlock &)> &consume);
+
+    QString errorString() const { return error; }
+    qint64 blockCount() const { return blocks; }
+
+private:
+    struct Blob {
+        QByteArray type;
+        QByteArray data;
+    };
+
+    bool readBlob(QFile &file, Blob &blob);
+    bool checkHeader(const QByteArray &data);
+
+    QThreadPool pool;
+    QString error;
+    qint64 blocks = 0;
+};
+
+#endif // OSMPBFREADER_H
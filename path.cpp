@@ -1,12 +1,14 @@
 #include "path.h"
+#include "shapearena.h"
 #include <QDebug>
+#include <algorithm>
 
 Path::Path()
     : pathLength(0.0)
 {
 }
 
-Path::Path(const QList<Edge*>& edges, qint64 startNodeId)
+Path::Path(const QList<Edge*>& edges, qint64 startNodeId, const LocalProjection &projection)
     : pathLength(0.0)
 {
     if (edges.isEmpty()) {
@@ -15,6 +17,7 @@ Path::Path(const QList<Edge*>& edges, qint64 startNodeId)
 
     double cumulative = 0.0;
     qint64 currentNode = startNodeId;
+    QVector<ShapePoint> shape;
 
     for (Edge* e : edges) {
         if (!e) {
@@ -33,10 +36,39 @@ Path::Path(const QList<Edge*>& edges, qint64 startNodeId)
             forward = true;
         }
 
+        const Node *fromNode = forward ? e->start : e->end;
+        const Node *toNode = forward ? e->end : e->start;
+        const PlanePoint from = projection.project(fromNode->latitude, fromNode->longitude);
+        const PlanePoint to = projection.project(toNode->latitude, toNode->longitude);
+
+        // One segment per straight piece between the points of the shape
         PathSegment seg;
         seg.edge = e;
         seg.forward = forward;
+        seg.startsAtNode = true;
         seg.cumulativeLength = cumulative;
+        seg.fromX = from.x;
+        seg.fromY = from.y;
+        double offset = 0.0;
+        shape.clear();
+        ShapeArena::decode(*e, forward, 0.0, shape);
+        for (const ShapePoint &point : std::as_const(shape)) {
+            const double pointOffset = qBound(offset, point.offset, e->length);
+            const PlanePoint position = projection.project(point.latitude, point.longitude);
+            seg.length = pointOffset - offset;
+            seg.toX = position.x;
+            seg.toY = position.y;
+            segments.append(seg);
+
+            seg.startsAtNode = false;
+            seg.cumulativeLength = cumulative + pointOffset;
+            seg.fromX = position.x;
+            seg.fromY = position.y;
+            offset = pointOffset;
+        }
+        seg.length = e->length - offset;
+        seg.toX = to.x;
+        seg.toY = to.y;
         segments.append(seg);
 
         cumulative += e->length;
@@ -50,49 +82,41 @@ double Path::totalLength() const
     return pathLength;
 }
 
-QGeoCoordinate Path::getPositionAtDistance(double distance) const
+PlanePoint Path::getPositionAtDistance(double distance) const
 {
     if (segments.isEmpty()) {
-        return QGeoCoordinate();
+        return PlanePoint();
     }
 
     if (distance <= 0.0) {
         const PathSegment& firstSeg = segments.first();
-        return firstSeg.forward ? firstSeg.edge->start->coordinate
-                                : firstSeg.edge->end->coordinate;
+        return {firstSeg.fromX, firstSeg.fromY};
     }
 
     if (distance >= pathLength) {
         const PathSegment& lastSeg = segments.last();
-        return lastSeg.forward ? lastSeg.edge->end->coordinate
-                               : lastSeg.edge->start->coordinate;
-    }
-
-    int segIndex = 0;
-    while (segIndex < segments.size() - 1 &&
-           distance >= segments[segIndex + 1].cumulativeLength)
-    {
-        segIndex++;
+        return {lastSeg.toX, lastSeg.toY};
     }
 
-    const PathSegment& seg = segments[segIndex];
-    double segmentStart = seg.cumulativeLength;
-    double localDistance = distance - segmentStart;
-
-    QGeoCoordinate startCoord = seg.forward ? seg.edge->start->coordinate
-                                            : seg.edge->end->coordinate;
-    QGeoCoordinate endCoord   = seg.forward ? seg.edge->end->coordinate
-                                          : seg.edge->start->coordinate;
+    return positionInSegment(segmentIndexAt(distance), distance);
+}
 
-    double azimuth = startCoord.azimuthTo(endCoord);
-    return startCoord.atDistanceAndAzimuth(localDistance, azimuth);
+PlanePoint Path::positionInSegment(int index, double distance) const
+{
+    const PathSegment &seg = segments[index];
+    const double length = seg.length;
+    const double t = length > 0.0 ? qBound(0.0, (distance - seg.cumulativeLength) / length, 1.0) : 0.0;
+    return {seg.fromX + t * (seg.toX - seg.fromX),
+            seg.fromY + t * (seg.toY - seg.fromY)};
 }
 
 QList<Edge*> Path::getEdges() const
 {
     QList<Edge*> list;
     for (const PathSegment& seg : segments) {
-        list.append(seg.edge);
+        if (seg.startsAtNode) {
+            list.append(seg.edge);
+        }
     }
     return list;
 }
@@ -106,3 +130,32 @@ qint64 Path::getFinalNodeId() const
     return lastSeg.forward ? lastSeg.edge->end->id
                            : lastSeg.edge->start->id;
 }
+
+int Path::segmentIndexAt(double distance) const
+{
+    if (segments.isEmpty()) {
+        return 0;
+    }
+    // First segment starting after distance, minus one
+    auto it = std::upper_bound(segments.cbegin() + 1, segments.cend(), distance,
+                               [](double d, const PathSegment &seg) { return d < seg.cumulativeLength; });
+    return int(it - segments.cbegin()) - 1;
+}
+
+qint64 Path::getSegmentStartNodeId(int index) const
+{
+    if (index < 0 || index >= segments.size()) {
+        return -1;
+    }
+    const PathSegment &seg = segments[index];
+    return seg.forward ? seg.edge->start->id
+                       : seg.edge->end->id;
+}
+
+int Path::edgeStartSegment(int index) const
+{
+    while (index > 0 && !segments[index].startsAtNode) {
+        --index;
+    }
+    return index;
+}
@@ -2,18 +2,23 @@
 #define PATH_H
 
 #include <QList>
-#include <QGeoCoordinate>
 #include "edge.h"
+#include "localprojection.h"
 
 /**
  * @brief PathSegment
- * Représente un segment d'un chemin, c'est-à-dire l'utilisation
- * d'un Edge particulier dans un sens précis (forward ou backward).
+ * Représente un segment d'un chemin, c'est-à-dire une portion droite
+ * d'un Edge particulier parcouru dans un sens précis (forward ou backward).
+ * Un Edge qui suit la forme de la route donne un segment par portion.
  */
 struct PathSegment {
     Edge* edge;
     bool forward;             // true si on va de edge->start vers edge->end
+    bool startsAtNode;        // première portion de l'Edge : on y entre par un nœud
     double cumulativeLength;  // distance cumulée depuis le début du path
+    double length;            // longueur de la portion
+    double fromX, fromY;      // extrémité par laquelle on entre dans le segment (plan local, en mètres)
+    double toX, toY;          // extrémité par laquelle on en sort
 };
 
 class Path {
@@ -22,21 +27,30 @@ public:
     /**
      * @brief Construit un chemin à partir d'une liste d'Edges (dans l'ordre),
      *        et d'un node de départ pour déterminer le sens des segments.
+     *        Les positions sont exprimées dans le plan de projection donné.
      */
-    Path(const QList<Edge*>& edges, qint64 startNodeId);
+    Path(const QList<Edge*>& edges, qint64 startNodeId, const LocalProjection &projection);
 
     double totalLength() const;
 
     /**
      * @brief getPositionAtDistance
-     * Calcule la position (latitude/longitude) le long du chemin
+     * Calcule la position (dans le plan local) le long du chemin
      * en fonction d'une distance parcourue depuis le début du Path.
      */
-    QGeoCoordinate getPositionAtDistance(double distance) const;
+    PlanePoint getPositionAtDistance(double distance) const;
+
+    /**
+     * @brief positionInSegment
+     * Même chose quand le segment qui contient distance est déjà connu :
+     * interpolation linéaire entre ses extrémités, sans recherche ni
+     * trigonométrie.
+     */
+    PlanePoint positionInSegment(int index, double distance) const;
 
     /**
      * @brief getEdges
-     * Renvoie la liste des Edge* (sans précision de sens).
+     * Renvoie la liste des Edge* (sans précision de sens), une fois chacun.
      */
     QList<Edge*> getEdges() const;
 
@@ -46,6 +60,28 @@ public:
      */
     qint64 getFinalNodeId() const;
 
+    /**
+     * @brief segmentIndexAt
+     * Index du segment qui contient la distance donnée (0 si le path est vide),
+     * par recherche dichotomique.
+     */
+    int segmentIndexAt(double distance) const;
+
+    /**
+     * @brief getSegmentStartNodeId
+     * Renvoie l'ID du nœud par lequel on entre dans l'Edge du segment index.
+     */
+    qint64 getSegmentStartNodeId(int index) const;
+
+    /**
+     * @brief edgeStartSegment
+     * Index de la première portion de l'Edge qui contient le segment index.
+     */
+    int edgeStartSegment(int index) const;
+
+    int segmentCount() const { return segments.size(); }
+    const PathSegment &segment(int index) const { return segments[index]; }
+
 private:
     QList<PathSegment> segments;
     double pathLength;
@@ -0,0 +1,163 @@
+// routecache.cpp
+#include "routecache.h"
+#include "routingsnapshot.h"
+#include <QMutexLocker>
+
+namespace {
+
+quint64 mix(quint64 x)
+{
+    // splitmix64 finaliser
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+size_t qHash(const RouteCache::Key &key, size_t seed)
+{
+    return qHashMulti(seed, key.start, key.goal, key.avoidHash);
+}
+
+RouteCache::RouteCache(int capacity)
+    : shardCapacity(qMax(1, (capacity + ShardCount - 1) / ShardCount))
+{
+}
+
+RouteCache::Key RouteCache::makeKey(quint32 start, quint32 goal, const EdgeSet &avoidEdges)
+{
+    Key key;
+    key.start = start;
+    key.goal = goal;
+    // The ids come sorted, so chaining them gives one hash per set
+    for (quint32 edge : avoidEdges) {
+        key.avoidHash = mix(key.avoidHash ^ edge);
+    }
+    return key;
+}
+
+RouteCache::Shard &RouteCache::shardFor(const Key &key)
+{
+    return shards[mix(qHash(key)) % ShardCount];
+}
+
+QHash<RouteCache::Key, RouteCache::Entry>::iterator RouteCache::remove(Shard &shard, QHash<Key, Entry>::iterator it)
+{
+    for (quint32 edge : it->edges) {
+        shard.byEdge.remove(edge, it.key());
+    }
+    shard.recency.erase(it->position);
+    return shard.entries.erase(it);
+}
+
+bool RouteCache::lookup(const Key &key, QVector<quint32> &edges)
+{
+    Shard &shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        missCount.fetchAndAddRelaxed(1);
+        return false;
+    }
+    shard.recency.splice(shard.recency.begin(), shard.recency, it->position);
+    edges = it->edges;
+    hitCount.fetchAndAddRelaxed(1);
+    return true;
+}
+
+void RouteCache::insert(const Key &key, const QVector<quint32> &edges, double length, quint64 epoch)
+{
+    Shard &shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    // Checked under the shard lock: invalidation bumps the epoch before
+    // sweeping the shards, so a stale route is either refused or swept
+    if (epoch != currentEpoch.loadAcquire()) {
+        return;
+    }
+
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        remove(shard, it);
+    }
+    while (shard.entries.size() >= shardCapacity) {
+        remove(shard, shard.entries.find(shard.recency.back()));
+        evictionCount.fetchAndAddRelaxed(1);
+    }
+
+    shard.recency.push_front(key);
+    shard.entries.insert(key, Entry{edges, length, shard.recency.begin()});
+    for (quint32 edge : edges) {
+        shard.byEdge.insert(edge, key);
+    }
+}
+
+void RouteCache::invalidateBlockedEdge(quint32 edge)
+{
+    currentEpoch.fetchAndAddOrdered(1);
+    for (Shard &shard : shards) {
+        QMutexLocker locker(&shard.mutex);
+        const QList<Key> keys = shard.byEdge.values(edge);
+        for (const Key &key : keys) {
+            auto it = shard.entries.find(key);
+            if (it != shard.entries.end()) {
+                remove(shard, it);
+                invalidationCount.fetchAndAddRelaxed(1);
+            }
+        }
+    }
+}
+
+void RouteCache::invalidateUnblockedEdge(quint32 edge, const RoutingSnapshot &routing)
+{
+    currentEpoch.fetchAndAddOrdered(1);
+
+    const CsrGraph &csr = routing.csr();
+    const quint32 u = csr.edgeSource(edge);
+    const quint32 v = csr.edgeTarget(edge);
+    const double length = csr.edge(edge)->length;
+
+    for (Shard &shard : shards) {
+        QMutexLocker locker(&shard.mutex);
+        for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+            // Any route through the reopened edge is at least this long;
+            // unreachable entries (infinite length) always go
+            const Key &key = it.key();
+            const double viaEdge = length + qMin(routing.estimate(key.start, u) + routing.estimate(v, key.goal),
+                                                 routing.estimate(key.start, v) + routing.estimate(u, key.goal));
+            if (it->length <= viaEdge) {
+                ++it;
+                continue;
+            }
+            it = remove(shard, it);
+            invalidationCount.fetchAndAddRelaxed(1);
+        }
+    }
+}
+
+void RouteCache::clear()
+{
+    currentEpoch.fetchAndAddOrdered(1);
+    for (Shard &shard : shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.entries.clear();
+        shard.recency.clear();
+        shard.byEdge.clear();
+    }
+}
+
+RouteCache::Stats RouteCache::stats() const
+{
+    Stats stats;
+    stats.hits = hitCount.loadRelaxed();
+    stats.misses = missCount.loadRelaxed();
+    stats.invalidations = invalidationCount.loadRelaxed();
+    stats.evictions = evictionCount.loadRelaxed();
+    stats.capacity = shardCapacity * ShardCount;
+    for (const Shard &shard : shards) {
+        QMutexLocker locker(&shard.mutex);
+        stats.size += shard.entries.size();
+    }
+    return stats;
+}
@@ -0,0 +1,106 @@
+// routecache.h
+#ifndef ROUTECACHE_H
+#define ROUTECACHE_H
+
+#include <QAtomicInteger>
+#include <QHash>
+#include <QMultiHash>
+#include <QMutex>
+#include <QVector>
+#include <list>
+#include "edgeset.h"
+
+class RoutingSnapshot;
+
+/**
+ * @brief The RouteCache class
+ * Sharded LRU cache of computed routes, shared by every thread that routes
+ * on the same frozen graph.
+ *
+ * Entries are keyed by (start, goal, hash of the avoid set) in dense node
+ * indices and hold the route as dense edge ids. Blocking an edge drops
+ * exactly the routes that use it; unblocking one drops the routes it could
+ * shorten, judged with the routing lower bounds. Both bump the epoch, and
+ * insert() refuses results computed against an older epoch, so a query
+ * that was running during a change cannot store a stale route.
+ */
+class RouteCache {
+public:
+    static const int DefaultCapacity = 8192;
+
+    struct Key {
+        quint32 start = 0;
+        quint32 goal = 0;
+        quint64 avoidHash = 0;
+
+        bool operator==(const Key &other) const {
+            return start == other.start && goal == other.goal && avoidHash == other.avoidHash;
+        }
+    };
+
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 invalidations = 0;
+        quint64 evictions = 0;
+        int size = 0;
+        int capacity = 0;
+    };
+
+    explicit RouteCache(int capacity = DefaultCapacity);
+
+    static Key makeKey(quint32 start, quint32 goal, const EdgeSet &avoidEdges);
+
+    quint64 epoch() const { return currentEpoch.loadAcquire(); }
+
+    /**
+     * @brief lookup
+     * Copies the cached route into edges and returns true on a hit. An
+     * unreachable goal is cached too and comes back as a hit with no edges.
+     */
+    bool lookup(const Key &key, QVector<quint32> &edges);
+
+    /**
+     * @brief insert
+     * Stores a route of the given length (infinity when unreachable) that was
+     * computed at epoch. Ignored if the cache moved on since.
+     */
+    void insert(const Key &key, const QVector<quint32> &edges, double length, quint64 epoch);
+
+    void invalidateBlockedEdge(quint32 edge);
+    void invalidateUnblockedEdge(quint32 edge, const RoutingSnapshot &routing);
+    void clear();
+
+    Stats stats() const;
+
+private:
+    static const int ShardCount = 16;
+
+    struct Entry {
+        QVector<quint32> edges;
+        double length;
+        std::list<Key>::iterator position; // In the shard's recency list
+    };
+
+    struct Shard {
+        mutable QMutex mutex;
+        QHash<Key, Entry> entries;
+        std::list<Key> recency;           // Most recently used first
+        QMultiHash<quint32, Key> byEdge;  // Edge id -> cached routes using it
+    };
+
+    Shard &shardFor(const Key &key);
+    static QHash<Key, Entry>::iterator remove(Shard &shard, QHash<Key, Entry>::iterator it);
+
+    int shardCapacity;
+    Shard shards[ShardCount];
+    QAtomicInteger<quint64> currentEpoch;
+    QAtomicInteger<quint64> hitCount;
+    QAtomicInteger<quint64> missCount;
+    QAtomicInteger<quint64> invalidationCount;
+    QAtomicInteger<quint64> evictionCount;
+};
+
+size_t qHash(const RouteCache::Key &key, size_t seed = 0);
+
+#endif // ROUTECACHE_H
@@ -0,0 +1,76 @@
+// routingservice.cpp
+#include "routingservice.h"
+#include <QPromise>
+
+// Several chunks per worker so a few slow A* fallbacks do not leave
+// the other threads idle at the end of a batch
+static const int CHUNKS_PER_THREAD = 4;
+
+struct RoutingService::PendingRoute {
+    RouteRequest request;
+    QPromise<QList<Edge*>> promise;
+};
+
+RoutingService::RoutingService(Graph &graph, QObject *parent)
+    : QObject(parent), graph(graph)
+{
+}
+
+RoutingService::~RoutingService()
+{
+    // Unsubmitted promises cancel their futures when destroyed
+    pending.clear();
+    pool.waitForDone();
+}
+
+QFuture<QList<Edge*>> RoutingService::requestRoute(const RouteRequest &request)
+{
+    QSharedPointer<PendingRoute> route(new PendingRoute);
+    route->request = request;
+    QFuture<QList<Edge*>> future = route->promise.future();
+    pending.append(route);
+    return future;
+}
+
+QList<QFuture<QList<Edge*>>> RoutingService::requestRoutes(const QList<RouteRequest> &requests)
+{
+    QList<QFuture<QList<Edge*>>> futures;
+    futures.reserve(requests.size());
+    for (const RouteRequest &request : requests) {
+        futures.append(requestRoute(request));
+    }
+    submitPending();
+    return futures;
+}
+
+void RoutingService::submitPending()
+{
+    if (pending.isEmpty()) {
+        return;
+    }
+
+    const RoutingSnapshot snapshot = graph.snapshot();
+    const int chunkCount = qMin(int(pending.size()), qMax(1, pool.maxThreadCount()) * CHUNKS_PER_THREAD);
+    const int chunkSize = (int(pending.size()) + chunkCount - 1) / chunkCount;
+
+    for (int first = 0; first < pending.size(); first += chunkSize) {
+        const QList<QSharedPointer<PendingRoute>> chunk = pending.mid(first, chunkSize);
+        pool.start([snapshot, chunk]() {
+            for (const QSharedPointer<PendingRoute> &route : chunk) {
+                route->promise.start();
+                if (!route->promise.isCanceled()) {
+                    const CsrGraph &csr = snapshot.csr();
+                    const quint32 start = csr.indexOf(route->request.startId);
+                    const quint32 goal = csr.indexOf(route->request.goalId);
+                    QList<Edge*> path;
+                    if (start != CsrGraph::InvalidIndex && goal != CsrGraph::InvalidIndex) {
+                        path = snapshot.findPath(start, goal, route->request.avoidEdges);
+                    }
+                    route->promise.addResult(path);
+                }
+                route->promise.finish();
+            }
+        });
+    }
+    pending.clear();
+}
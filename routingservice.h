@@ -0,0 +1,70 @@
+// routingservice.h
+#ifndef ROUTINGSERVICE_H
+#define ROUTINGSERVICE_H
+
+#include <QObject>
+#include <QFuture>
+#include <QList>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include "graph.h"
+
+/**
+ * @brief RouteRequest
+ * One route to plan: OSM node ids plus the dense ids of the edges this
+ * requester knows to be blocked. The avoid set is copied, so later changes
+ * on the vehicle side do not leak into a query already running.
+ */
+struct RouteRequest {
+    qint64 startId = -1;
+    qint64 goalId = -1;
+    EdgeSet avoidEdges;
+};
+
+/**
+ * @brief The RoutingService class
+ * Plans routes on a worker pool instead of the GUI thread.
+ *
+ * requestRoute() only queues the request and hands back a future; queued
+ * requests are sent to the pool in chunks by submitPending(), each chunk
+ * querying a RoutingSnapshot of the graph taken at submission. Results are
+ * empty when no route exists or the future was cancelled. Requests and
+ * submission must come from the thread that owns the graph.
+ */
+class RoutingService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RoutingService(Graph &graph, QObject *parent = nullptr);
+    ~RoutingService() override;
+
+    QFuture<QList<Edge*>> requestRoute(const RouteRequest &request);
+
+    /**
+     * @brief requestRoutes
+     * Queues a batch of requests and submits everything pending at once.
+     */
+    QList<QFuture<QList<Edge*>>> requestRoutes(const QList<RouteRequest> &requests);
+
+    /**
+     * @brief submitPending
+     * Snapshots the graph and dispatches all queued requests to the pool.
+     */
+    void submitPending();
+    int pendingCount() const { return pending.size(); }
+
+    void setMaxThreadCount(int count) { pool.setMaxThreadCount(count); }
+    int maxThreadCount() const { return pool.maxThreadCount(); }
+
+    void waitForDone() { pool.waitForDone(); }
+
+private:
+    struct PendingRoute;
+
+    Graph &graph;
+    QThreadPool pool;
+    QList<QSharedPointer<PendingRoute>> pending;
+};
+
+#endif // ROUTINGSERVICE_H
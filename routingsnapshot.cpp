@@ -0,0 +1,138 @@
+// routingsnapshot.cpp
+#include "routingsnapshot.h"
+#include "searchworkspace.h"
+#include <algorithm>
+#include <limits>
+
+double RoutingSnapshot::estimate(quint32 a, quint32 b) const {
+    if (heuristicMode == Landmarks && landmarks) {
+        return landmarks->lowerBound(a, b);
+    }
+    // The plane reads longer than the sphere poleward of its origin, by up
+    // to the inverse of boundScale(); the slack covers the small remaining
+    // gap between the sphere and a flat band of the box's latitudes
+    return planeDistance(csrGraph.position(a), csrGraph.position(b)) * csrGraph.boundScale() * GeodesicSlack;
+}
+
+QList<Edge*> RoutingSnapshot::findPath(quint32 start, quint32 goal,
+                                       const EdgeSet &avoidEdges,
+                                       SearchStats *stats) const
+{
+    if (start >= csrGraph.nodeCount() || goal >= csrGraph.nodeCount()) {
+        return {};
+    }
+
+    QVector<quint32> pathEdges;
+    if (!cache) {
+        computePath(start, goal, avoidEdges, pathEdges, stats);
+        return toEdges(pathEdges);
+    }
+
+    const RouteCache::Key key = RouteCache::makeKey(start, goal, avoidEdges);
+    if (cache->lookup(key, pathEdges)) {
+        if (stats) {
+            stats->cacheHit = true;
+        }
+        return toEdges(pathEdges);
+    }
+
+    double length = std::numeric_limits<double>::infinity();
+    if (computePath(start, goal, avoidEdges, pathEdges, stats)) {
+        length = 0.0;
+        for (quint32 edge : pathEdges) {
+            length += csrGraph.edge(edge)->length;
+        }
+    }
+    cache->insert(key, pathEdges, length, cacheEpoch);
+    return toEdges(pathEdges);
+}
+
+QList<Edge*> RoutingSnapshot::toEdges(const QVector<quint32> &pathEdges) const
+{
+    QList<Edge*> path;
+    path.reserve(pathEdges.size());
+    for (quint32 edge : pathEdges) {
+        path.append(csrGraph.edge(edge));
+    }
+    return path;
+}
+
+bool RoutingSnapshot::computePath(quint32 start, quint32 goal,
+                                  const EdgeSet &avoidEdges,
+                                  QVector<quint32> &pathEdges, SearchStats *stats) const
+{
+    if (contractionHierarchy) {
+        if (stats) {
+            stats->usedHierarchy = true;
+        }
+        if (!contractionHierarchy->query(start, goal, pathEdges)) {
+            return false; // Unreachable even with every edge open
+        }
+
+        bool usable = true;
+        for (quint32 edge : pathEdges) {
+            if (csrGraph.isBlocked(edge) || avoidEdges.contains(edge)) {
+                usable = false;
+                break;
+            }
+        }
+        if (usable) {
+            return true;
+        }
+        pathEdges.clear();
+    }
+
+    return findPathAStar(start, goal, avoidEdges, pathEdges, stats);
+}
+
+bool RoutingSnapshot::findPathAStar(quint32 start, quint32 goal,
+                                    const EdgeSet &avoidEdges,
+                                    QVector<quint32> &pathEdges, SearchStats *stats) const
+{
+    SearchWorkspace &workspace = SearchWorkspace::local();
+    workspace.prepare(csrGraph.nodeCount());
+    workspace.markAvoided(avoidEdges, csrGraph.edgeCount());
+    IndexedHeap &openSet = workspace.heap;
+    bool found = false;
+
+    workspace.reach(start, 0.0);
+    openSet.pushOrDecrease(start, estimate(start, goal));
+
+    while (!openSet.isEmpty()) {
+        const quint32 current = openSet.popMin();
+        if (stats) {
+            stats->expandedNodes++;
+        }
+
+        if (current == goal) {
+            // Reconstruct the path
+            for (quint32 curr = goal; curr != start; curr = workspace.parentNode(curr)) {
+                pathEdges.append(csrGraph.arcEdge(workspace.parentArc(curr)));
+            }
+            std::reverse(pathEdges.begin(), pathEdges.end());
+            found = true;
+            break;
+        }
+
+        const double currentG = workspace.distance(current);
+
+        // Explore neighbors
+        for (quint32 arc = csrGraph.arcBegin(current); arc < csrGraph.arcEnd(current); ++arc) {
+            // Skip blocked edges and any additional avoidEdges
+            const quint32 edge = csrGraph.arcEdge(arc);
+            if (csrGraph.isBlocked(edge) || workspace.isAvoided(edge)) {
+                continue;
+            }
+
+            const quint32 neighbor = csrGraph.arcTarget(arc);
+
+            double tentativeGScore = currentG + csrGraph.arcLength(arc);
+            if (tentativeGScore < workspace.distance(neighbor)) {
+                workspace.reach(neighbor, tentativeGScore, arc, current);
+                openSet.pushOrDecrease(neighbor, tentativeGScore + estimate(neighbor, goal));
+            }
+        }
+    }
+    workspace.unmarkAvoided(avoidEdges);
+    return found;
+}
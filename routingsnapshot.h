@@ -0,0 +1,88 @@
+// routingsnapshot.h
+#ifndef ROUTINGSNAPSHOT_H
+#define ROUTINGSNAPSHOT_H
+
+#include <QList>
+#include <QSharedPointer>
+#include "edge.h"
+#include "csrgraph.h"
+#include "edgeset.h"
+#include "contractionhierarchy.h"
+#include "landmarks.h"
+#include "routecache.h"
+
+/**
+ * @brief SearchStats
+ * Work done by one findPath call, for comparing heuristics.
+ */
+struct SearchStats {
+    int expandedNodes = 0;
+    bool usedHierarchy = false;
+    bool cacheHit = false;
+};
+
+/**
+ * @brief The RoutingSnapshot class
+ * Everything a route query reads: the CSR arrays with their blocked flags,
+ * the contraction hierarchy and the landmark tables.
+ *
+ * Copies are cheap (the arrays are implicitly shared and the preprocessing
+ * is held through shared pointers) and never change afterwards, so a copy
+ * can be queried from any thread while the graph keeps blocking and
+ * unblocking edges. The Edge pointers handed out belong to the Graph the
+ * snapshot was taken from, which must outlive it.
+ *
+ * The route cache is the one mutable part: it is shared with the graph and
+ * stamped with the cache epoch current when the snapshot was taken.
+ */
+class RoutingSnapshot {
+public:
+    enum Heuristic {
+        Geodesic,  // straight-line distance to the goal on the local plane
+        Landmarks  // ALT lower bound from the landmark tables
+    };
+
+    RoutingSnapshot() = default;
+
+    bool isEmpty() const { return csrGraph.isEmpty(); }
+    const CsrGraph& csr() const { return csrGraph; }
+    Heuristic heuristic() const { return heuristicMode; }
+    bool hasContractionHierarchy() const { return !contractionHierarchy.isNull(); }
+    RouteCache *routeCache() const { return cache.data(); }
+
+    /**
+     * @brief findPath
+     * Shortest path between two dense node indices. Uses the contraction
+     * hierarchy when one is built and falls back to A* if its route crosses
+     * a blocked or avoided edge.
+     */
+    QList<Edge*> findPath(quint32 start, quint32 goal,
+                          const EdgeSet &avoidEdges = {},
+                          SearchStats *stats = nullptr) const;
+
+    // Routing helper shared with the incremental planner
+    double estimate(quint32 a, quint32 b) const;
+
+private:
+    static constexpr double GeodesicSlack = 0.998;
+
+    bool computePath(quint32 start, quint32 goal,
+                     const EdgeSet &avoidEdges,
+                     QVector<quint32> &pathEdges, SearchStats *stats) const;
+    bool findPathAStar(quint32 start, quint32 goal,
+                       const EdgeSet &avoidEdges,
+                       QVector<quint32> &pathEdges, SearchStats *stats) const;
+    QList<Edge*> toEdges(const QVector<quint32> &pathEdges) const;
+
+    CsrGraph csrGraph;
+    QSharedPointer<const ContractionHierarchy> contractionHierarchy;
+    QSharedPointer<const LandmarkSet> landmarks;
+    Heuristic heuristicMode = Geodesic;
+    QSharedPointer<RouteCache> cache;
+    quint64 cacheEpoch = 0;
+
+    friend class Graph;
+    friend class GraphSnapshot;
+};
+
+#endif // ROUTINGSNAPSHOT_H
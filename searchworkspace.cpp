@@ -0,0 +1,130 @@
+// searchworkspace.cpp
+#include "searchworkspace.h"
+
+void IndexedHeap::reserve(quint32 nodeCount)
+{
+    if (quint32(positions.size()) < nodeCount) {
+        positions.resize(nodeCount, NotInHeap);
+    }
+}
+
+void IndexedHeap::pushOrDecrease(quint32 node, double key)
+{
+    quint32 position = positions[node];
+    if (position == NotInHeap) {
+        heap.append({key, node});
+        positions[node] = quint32(heap.size() - 1);
+        siftUp(heap.size() - 1);
+    } else if (key < heap[position].key) {
+        heap[position].key = key;
+        siftUp(int(position));
+    }
+}
+
+quint32 IndexedHeap::popMin()
+{
+    const quint32 node = heap.first().node;
+    positions[node] = NotInHeap;
+
+    const Entry last = heap.takeLast();
+    if (!heap.isEmpty()) {
+        place(0, last);
+        siftDown(0);
+    }
+    return node;
+}
+
+void IndexedHeap::clear()
+{
+    for (const Entry &entry : heap) {
+        positions[entry.node] = NotInHeap;
+    }
+    heap.clear();
+}
+
+void IndexedHeap::siftUp(int index)
+{
+    const Entry entry = heap[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (heap[parent].key <= entry.key) {
+            break;
+        }
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, entry);
+}
+
+void IndexedHeap::siftDown(int index)
+{
+    const Entry entry = heap[index];
+    const int count = heap.size();
+    while (true) {
+        int child = 2 * index + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && heap[child + 1].key < heap[child].key) {
+            child++;
+        }
+        if (entry.key <= heap[child].key) {
+            break;
+        }
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, entry);
+}
+
+void IndexedHeap::place(int index, const Entry &entry)
+{
+    heap[index] = entry;
+    positions[entry.node] = quint32(index);
+}
+
+SearchWorkspace &SearchWorkspace::local(int slot)
+{
+    thread_local SearchWorkspace workspaces[2];
+    return workspaces[slot];
+}
+
+void SearchWorkspace::prepare(quint32 nodeCount)
+{
+    if (quint32(stamps.size()) < nodeCount) {
+        stamps.resize(nodeCount, 0);
+        gScores.resize(nodeCount);
+        parentArcs.resize(nodeCount);
+        parentNodes.resize(nodeCount);
+    }
+    heap.reserve(nodeCount);
+    heap.clear();
+
+    // Stamp 0 means "never reached"; on wrap-around do the one real reset
+    if (++generation == 0) {
+        stamps.fill(0);
+        generation = 1;
+    }
+}
+
+void SearchWorkspace::markAvoided(const EdgeSet &edges, quint32 edgeCount)
+{
+    if (avoidedCapacity < edgeCount) {
+        avoided.resize(edgeCount);
+        avoidedCapacity = edgeCount;
+    }
+    for (quint32 edge : edges) {
+        if (edge < avoidedCapacity) {
+            avoided.set(edge);
+        }
+    }
+}
+
+void SearchWorkspace::unmarkAvoided(const EdgeSet &edges)
+{
+    for (quint32 edge : edges) {
+        if (edge < avoidedCapacity) {
+            avoided.reset(edge);
+        }
+    }
+}
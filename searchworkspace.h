@@ -0,0 +1,115 @@
+// searchworkspace.h
+#ifndef SEARCHWORKSPACE_H
+#define SEARCHWORKSPACE_H
+
+#include <QVector>
+#include <limits>
+#include "edgeset.h"
+
+/**
+ * @brief The IndexedHeap class
+ * Binary min-heap over dense node indices with in-place decrease-key,
+ * so every node sits in the heap at most once.
+ */
+class IndexedHeap {
+public:
+    static constexpr quint32 NotInHeap = 0xFFFFFFFFu;
+
+    void reserve(quint32 nodeCount);
+
+    bool isEmpty() const { return heap.isEmpty(); }
+    int size() const { return heap.size(); }
+    bool contains(quint32 node) const { return positions[node] != NotInHeap; }
+    double minKey() const { return heap.first().key; }
+
+    /**
+     * @brief pushOrDecrease
+     * Inserts node with the given key, or lowers its key if already queued.
+     * Raising the key of a queued node is ignored.
+     */
+    void pushOrDecrease(quint32 node, double key);
+    quint32 popMin();
+
+    /**
+     * @brief clear
+     * Empties the heap in O(size()), leaving the position table clean.
+     */
+    void clear();
+
+private:
+    struct Entry {
+        double key;
+        quint32 node;
+    };
+
+    void siftUp(int index);
+    void siftDown(int index);
+    void place(int index, const Entry &entry);
+
+    QVector<Entry> heap;
+    QVector<quint32> positions; // heap slot per node, NotInHeap otherwise
+};
+
+/**
+ * @brief The SearchWorkspace class
+ * Reusable per-thread scratch state for shortest path queries.
+ *
+ * Scores and parents live in dense arrays indexed by node. A node's entry is
+ * only meaningful if its stamp equals the current generation, so starting a
+ * new query is a counter increment instead of an O(N) reset.
+ */
+class SearchWorkspace {
+public:
+    static constexpr quint32 NoParent = 0xFFFFFFFFu;
+
+    /**
+     * @brief local
+     * Workspace owned by the calling thread. Bidirectional searches use
+     * slot 0 for the forward side and slot 1 for the backward side.
+     */
+    static SearchWorkspace &local(int slot = 0);
+
+    /**
+     * @brief prepare
+     * Starts a new query over a graph of nodeCount nodes.
+     */
+    void prepare(quint32 nodeCount);
+
+    bool isReached(quint32 node) const { return stamps[node] == generation; }
+    double distance(quint32 node) const {
+        return isReached(node) ? gScores[node] : std::numeric_limits<double>::infinity();
+    }
+    quint32 parentArc(quint32 node) const { return parentArcs[node]; }
+    quint32 parentNode(quint32 node) const { return parentNodes[node]; }
+
+    void reach(quint32 node, double g, quint32 viaArc = NoParent, quint32 fromNode = NoParent) {
+        stamps[node] = generation;
+        gScores[node] = g;
+        parentArcs[node] = viaArc;
+        parentNodes[node] = fromNode;
+    }
+
+    /**
+     * @brief markAvoided
+     * Sets the bits of an avoid set in this thread's edge bitset for the
+     * coming search, which then tests avoided edges with a single bit.
+     * unmarkAvoided() clears the same bits afterwards, so neither side
+     * costs more than the size of the set.
+     */
+    void markAvoided(const EdgeSet &edges, quint32 edgeCount);
+    void unmarkAvoided(const EdgeSet &edges);
+    bool isAvoided(quint32 edge) const { return avoided.test(edge); }
+
+    IndexedHeap heap;
+
+private:
+    quint32 generation = 0;
+    QVector<quint32> stamps;
+    QVector<double> gScores;
+    QVector<quint32> parentArcs;
+    QVector<quint32> parentNodes;
+    EdgeBitset avoided;
+    quint32 avoidedCapacity = 0;
+};
+
+#endif // SEARCHWORKSPACE_H
@@ -0,0 +1,81 @@
+// shapearena.cpp
+#include "shapearena.h"
+#include <algorithm>
+
+namespace {
+
+constexpr double CoordinateScale = 1e7; // Steps per degree, about 1 cm
+constexpr double DistanceScale = 100.0; // Steps per meter
+
+void writeVarint(QVector<quint8> &bytes, qint64 value) {
+    quint64 zigzag = (quint64(value) << 1) ^ quint64(value >> 63);
+    while (zigzag >= 0x80) {
+        bytes.append(quint8(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    bytes.append(quint8(zigzag));
+}
+
+qint64 readVarint(const quint8 *&cursor) {
+    quint64 value = 0;
+    int shift = 0;
+    quint8 byte;
+    do {
+        byte = *cursor++;
+        value |= quint64(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+} // namespace
+
+quint32 ShapeArena::append(double startLatitude, double startLongitude, const QVector<ShapePoint> &points)
+{
+    const quint32 offset = quint32(bytes.size());
+    qint64 latitude = qRound64(startLatitude * CoordinateScale);
+    qint64 longitude = qRound64(startLongitude * CoordinateScale);
+    qint64 distance = 0;
+    for (const ShapePoint &point : points) {
+        const qint64 pointLatitude = qRound64(point.latitude * CoordinateScale);
+        const qint64 pointLongitude = qRound64(point.longitude * CoordinateScale);
+        const qint64 pointDistance = qRound64(point.offset * DistanceScale);
+        writeVarint(bytes, pointLatitude - latitude);
+        writeVarint(bytes, pointLongitude - longitude);
+        writeVarint(bytes, pointDistance - distance);
+        latitude = pointLatitude;
+        longitude = pointLongitude;
+        distance = pointDistance;
+    }
+    return offset;
+}
+
+void ShapeArena::decode(const Edge &edge, bool forward, double base, QVector<ShapePoint> &points)
+{
+    if (!edge.hasShape()) {
+        return;
+    }
+
+    const quint8 *cursor = edge.shapeArena->bytes.constData() + edge.shapeOffset;
+    qint64 latitude = qRound64(edge.start->latitude * CoordinateScale);
+    qint64 longitude = qRound64(edge.start->longitude * CoordinateScale);
+    qint64 distance = 0;
+    const qsizetype first = points.size();
+    for (quint32 i = 0; i < edge.shapeSize; ++i) {
+        latitude += readVarint(cursor);
+        longitude += readVarint(cursor);
+        distance += readVarint(cursor);
+        points.append(ShapePoint{latitude / CoordinateScale, longitude / CoordinateScale, distance / DistanceScale});
+    }
+
+    if (forward) {
+        for (qsizetype i = first; i < points.size(); ++i) {
+            points[i].offset += base;
+        }
+    } else {
+        std::reverse(points.begin() + first, points.end());
+        for (qsizetype i = first; i < points.size(); ++i) {
+            points[i].offset = base + edge.length - points[i].offset;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+// shapearena.h
+#ifndef SHAPEARENA_H
+#define SHAPEARENA_H
+
+#include <QVector>
+#include "edge.h"
+
+/**
+ * @brief ShapePoint
+ * Decoded point of a road shape.
+ */
+struct ShapePoint {
+    double latitude;
+    double longitude;
+    double offset; // Distance from edge->start along the road, in meters
+};
+
+/**
+ * @brief The ShapeArena class
+ * Append-only byte buffer holding the road shapes of a graph's edges.
+ *
+ * Each point is stored as zigzag varints: its latitude and longitude in
+ * 1e-7 degree steps relative to the previous point (the edge's start node
+ * for the first one), then its distance from the previous point in
+ * centimetres. Points of a road are a few tens of meters apart, so a point
+ * usually takes five or six bytes and the shape costs far less than the
+ * nodes it replaces. Shapes are decoded whole when a Path is built from
+ * them, so nothing needs random access into the buffer.
+ */
+class ShapeArena {
+public:
+    ShapeArena() = default;
+
+    /**
+     * @brief append
+     * Encodes points, ordered from start with increasing offsets, and
+     * returns their byte offset in the arena.
+     */
+    quint32 append(double startLatitude, double startLongitude, const QVector<ShapePoint> &points);
+
+    /**
+     * @brief decode
+     * Appends the shape of edge to points, walked from edge.start when
+     * forward and from edge.end otherwise, offsets counted from that end
+     * plus base.
+     */
+    static void decode(const Edge &edge, bool forward, double base, QVector<ShapePoint> &points);
+
+    qsizetype byteSize() const { return bytes.size(); }
+
+private:
+    QVector<quint8> bytes;
+
+    friend class GraphSnapshot;
+};
+
+#endif // SHAPEARENA_H
@@ -0,0 +1,82 @@
+// simulationclock.cpp
+#include "simulationclock.h"
+#include <cmath>
+
+static const int PACED_INTERVAL_MS = 16;      // Approximately 60 FPS
+static const int MAX_PACED_STEPS = 240;       // Per timer tick, before dropping the backlog
+static const qint64 FREE_RUN_SLICE_NS = 10000000; // 10 ms of stepping per event loop turn
+
+SimulationClock::SimulationClock(QObject *parent)
+    : QObject(parent)
+{
+    connect(&timer, &QTimer::timeout, this, &SimulationClock::onTimeout);
+}
+
+void SimulationClock::setMode(Mode mode)
+{
+    clockMode = mode;
+    if (timer.isActive()) {
+        start(); // Re-arm with the new mode's interval
+    }
+}
+
+void SimulationClock::setTimeStep(double seconds)
+{
+    if (seconds > 0.0) {
+        dt = seconds;
+    }
+}
+
+void SimulationClock::start()
+{
+    backlog = 0.0;
+    wallTimer.start();
+    timer.start(clockMode == Paced ? PACED_INTERVAL_MS : 0);
+}
+
+void SimulationClock::stop()
+{
+    timer.stop();
+}
+
+void SimulationClock::step()
+{
+    elapsed += dt;
+    steps++;
+    emit stepped(dt);
+}
+
+void SimulationClock::runFor(double seconds)
+{
+    const qint64 count = qint64(std::ceil(seconds / dt - 1e-9));
+    for (qint64 i = 0; i < count; ++i) {
+        step();
+    }
+}
+
+void SimulationClock::onTimeout()
+{
+    if (clockMode == FreeRunning) {
+        QElapsedTimer slice;
+        slice.start();
+        do {
+            step();
+        } while (slice.nsecsElapsed() < FREE_RUN_SLICE_NS);
+        emit frameAdvanced();
+        return;
+    }
+
+    backlog += wallTimer.restart() / 1000.0 * speed;
+    int count = int(backlog / dt);
+    if (count > MAX_PACED_STEPS) {
+        // Too far behind: run what fits and slow down rather than spiral
+        count = MAX_PACED_STEPS;
+        backlog = 0.0;
+    } else {
+        backlog -= count * dt;
+    }
+    for (int i = 0; i < count; ++i) {
+        step();
+    }
+    emit frameAdvanced();
+}
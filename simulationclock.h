@@ -0,0 +1,83 @@
+// simulationclock.h
+#ifndef SIMULATIONCLOCK_H
+#define SIMULATIONCLOCK_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+/**
+ * @brief The SimulationClock class
+ * Fixed-timestep clock that drives the simulation and that every subsystem
+ * reads instead of wall time.
+ *
+ * Each step advances simulated time by exactly timeStep() and emits
+ * stepped(); the same number of steps therefore gives the same run whatever
+ * the machine. In Paced mode a 16 ms timer converts elapsed wall time (times
+ * the speed factor) into steps, dropping the backlog when the machine cannot
+ * keep up. In FreeRunning mode steps run back to back, in batches so the
+ * event loop still turns; runFor() steps synchronously with no event loop.
+ */
+class SimulationClock : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Mode {
+        Paced,       // follows wall time scaled by the speed factor
+        FreeRunning  // as fast as the CPU allows
+    };
+
+    static constexpr double DefaultTimeStep = 1.0 / 60.0;
+
+    explicit SimulationClock(QObject *parent = nullptr);
+
+    void setMode(Mode mode);
+    Mode mode() const { return clockMode; }
+
+    void setTimeStep(double seconds);
+    double timeStep() const { return dt; }
+
+    // Simulated seconds per wall second in Paced mode; 0 pauses
+    void setSpeedFactor(double factor) { speed = qMax(0.0, factor); }
+    double speedFactor() const { return speed; }
+
+    double now() const { return elapsed; }
+    qint64 stepCount() const { return steps; }
+
+    void start();
+    void stop();
+    bool isRunning() const { return timer.isActive(); }
+
+    /**
+     * @brief step
+     * Advances by one time step and emits stepped().
+     */
+    void step();
+
+    /**
+     * @brief runFor
+     * Steps synchronously until seconds of simulated time have passed.
+     */
+    void runFor(double seconds);
+
+signals:
+    void stepped(double deltaTime);
+    void frameAdvanced(); // After each batch of steps run from the timer
+
+private slots:
+    void onTimeout();
+
+private:
+    Mode clockMode = Paced;
+    double dt = DefaultTimeStep;
+    double speed = 1.0;
+    double elapsed = 0.0;
+    qint64 steps = 0;
+    double backlog = 0.0;
+
+    QTimer timer;
+    QElapsedTimer wallTimer;
+};
+
+#endif // SIMULATIONCLOCK_H
@@ -2,27 +2,37 @@
 
 #include "simulationmanager.h"
 #include <QQueue>
-#include <QColor>
-#include <QDateTime>
+#include <limits>
 
 SimulationManager::SimulationManager(Graph &graph, QObject *parent)
-    : QObject(parent), graph(graph)
+    : SimulationManager(graph, QRandomGenerator::global()->generate64(), parent)
 {
-    // Connect simulation timer to updateVehicles slot
-    connect(&simulationTimer, &QTimer::timeout, this, &SimulationManager::updateVehicles);
-    simulationTimer.start(16); // Approximately 60 FPS
-    elapsedTimer.start();
-
-    // Initialize BlockedEdgesModel with current blocked edges
-    m_blockedEdgesModel->updateBlockedEdges(graph.getBlockedEdges(), graph.getEdges());
+}
 
-    // Setup edge blockage timer
-    connect(&edgeBlockTimer, &QTimer::timeout, this, &SimulationManager::blockRandomEdge);
-    edgeBlockTimer.start(30000); // Block an edge every 30 seconds
+SimulationManager::SimulationManager(Graph &graph, quint64 seed, QObject *parent)
+    : QObject(parent), graph(graph), routingService(graph), store(graph),
+    random(quint32(seed ^ (seed >> 32))), obstacles(graph),
+    nextEdgeBlockTime(edgeBlockInterval)
+{
+    // Every simulation step comes from the clock; the map repaints once per frame
+    connect(&simulationClock, &SimulationClock::stepped, this, &SimulationManager::advance);
+    connect(&simulationClock, &SimulationClock::frameAdvanced, this, &SimulationManager::updated);
+    m_visibleBlockedEdges->setSourceModel(m_blockedEdgesModel);
+    store.setRoutingService(&routingService);
+    store.setSeed(seed);
+    simulationClock.start();
+
+    // Obstacles change in the registry only; vehicles and the map follow its events
+    connect(&obstacles, &ObstacleRegistry::edgeBlocked, this, [this](quint32 edge) {
+        store.notifyEdgeStateChanged(edge);
+    });
+    connect(&obstacles, &ObstacleRegistry::edgeUnblocked, this, [this](quint32 edge) {
+        store.notifyEdgeStateChanged(edge);
+    });
+    m_blockedEdgesModel->setRegistry(&obstacles);
 
-    // Setup unblock timer
-    connect(&unblockTimer, &QTimer::timeout, this, &SimulationManager::unblockExpiredEdges);
-    unblockTimer.start(5000); // Check every 5 seconds
+    // Edges already blocked in the graph expire like new obstacles
+    obstacles.adoptBlockedEdges(simulationClock.now(), obstacleDuration);
 
     // Block initial 20 edges to maintain around 20 blocked edges
     placeRandomObstacles(20);
@@ -30,120 +40,141 @@ SimulationManager::SimulationManager(Graph &graph, QObject *parent)
 
 void SimulationManager::addVehicle(int id, qint64 startNodeId)
 {
-    if (!graph.nodes.isEmpty()) {
-        Vehicle *vehicle = new Vehicle(id, graph, startNodeId, this); // Parent set to SimulationManager
-        vehicles.append(vehicle);
+    if (graph.nodeCount() > 0) {
+        store.add(id, startNodeId);
         emit vehiclesUpdated(); // Notify QML about the new vehicle
     } else {
         qWarning() << "Graph is empty; cannot add vehicle" << id;
     }
 }
 
-void SimulationManager::updateVehicles()
+void SimulationManager::advance(double deltaTime)
 {
-    qint64 elapsedMs = elapsedTimer.elapsed();
-    elapsedTimer.restart();
+    // Update each vehicle’s position, then broadcast the obstacles they ran into
+    store.update(deltaTime);
+    for (const VehicleStore::ObstacleReport &report : store.takeObstacleReports()) {
+        handleObstacle(report.vehicle, report.edge);
+    }
 
-    double deltaTime = (elapsedMs / 1000.0) * speedFactor;
+    // Route requests made during this tick go to the worker pool as one batch
+    routingService.submitPending();
 
-    // Update each vehicle’s position
-    for (Vehicle *v : vehicles) {
-        v->updatePosition(deltaTime);
+    const double now = simulationClock.now();
+    // Links only show a transient broadcast
+    if (m_communicationLinksModel->expire(now) > 0) {
+        emit communicationLinksChanged();
     }
-
-    emit updated();
-    emit vehiclesUpdated();
+    if (now >= nextEdgeBlockTime) {
+        nextEdgeBlockTime += edgeBlockInterval;
+        blockRandomEdge();
+    }
+    // Only obstacles that are due are looked at
+    unblockExpiredEdges();
 }
 
-void SimulationManager::setSpeedFactor(double factor)
+void SimulationManager::setViewport(const QGeoRectangle &region)
 {
-    speedFactor = factor;
+    m_visibleBlockedEdges->setViewport(region);
 }
 
-void SimulationManager::clearVehicles()
+QVariantMap SimulationManager::metrics() const
 {
-    qDebug() << "Clearing vehicles...";
-    for (auto vehicle : vehicles) {
-        if (vehicle) {
-            disconnect(vehicle, nullptr, nullptr, nullptr);  // Disconnect all signals/slots
-            delete vehicle;  // Delete the object
+    double distance = 0.0;
+    qint64 trips = 0;
+    qint64 replans = 0;
+    int waiting = 0;
+    for (int i = 0; i < store.size(); ++i) {
+        distance += store.distanceTravelled(i);
+        trips += store.tripsCompleted(i);
+        replans += store.replanCount(i);
+        if (store.isWaitingForRoute(i)) {
+            waiting++;
         }
     }
-    vehicles.clear();  // Clear the list
-    emit vehiclesUpdated(); // Notify QML about the change
-    qDebug() << "All vehicles have been cleared.";
-}
 
-QQmlListProperty<QObject> SimulationManager::vehiclesModel()
-{
-    return QQmlListProperty<QObject>(this, this,
-                                     &SimulationManager::appendVehicle,
-                                     &SimulationManager::vehicleCount,
-                                     &SimulationManager::vehicleAt,
-                                     &SimulationManager::clearVehicles);
+    QVariantMap map;
+    map["vehicles"] = store.size();
+    map["seed"] = QString::number(store.seed());
+    map["threads"] = store.threadCount();
+    map["steps"] = simulationClock.stepCount();
+    map["simulatedSeconds"] = simulationClock.now();
+    map["distanceTravelledMeters"] = distance;
+    map["tripsCompleted"] = trips;
+    map["replans"] = replans;
+    map["vehiclesWaitingForRoute"] = waiting;
+    map["obstacleReports"] = obstacleReports;
+    map["messagesDelivered"] = messagesDelivered;
+    map["blockedEdges"] = graph.blockedEdgeCount();
+    map["routeCache"] = routeCacheStats();
+    return map;
 }
 
-void SimulationManager::appendVehicle(QQmlListProperty<QObject> *list, QObject *vehicle)
+void SimulationManager::setSpeedFactor(double factor)
 {
-    SimulationManager *manager = qobject_cast<SimulationManager*>(list->object);
-    if (manager && vehicle) {
-        manager->vehicles.append(qobject_cast<Vehicle*>(vehicle));
-    }
+    simulationClock.setSpeedFactor(factor);
 }
 
-qint64 SimulationManager::vehicleCount(QQmlListProperty<QObject> *list)
+void SimulationManager::clearVehicles()
 {
-    SimulationManager *manager = qobject_cast<SimulationManager*>(list->object);
-    return manager ? manager->vehicles.size() : 0;
+    qDebug() << "Clearing vehicles...";
+    store.clear();
+    emit vehiclesUpdated(); // Notify QML about the change
+    qDebug() << "All vehicles have been cleared.";
 }
 
-QObject* SimulationManager::vehicleAt(QQmlListProperty<QObject> *list, qint64 index)
+Graph& SimulationManager::getGraph()
 {
-    SimulationManager *manager = qobject_cast<SimulationManager*>(list->object);
-    return (manager && index >= 0 && index < manager->vehicles.size()) ? manager->vehicles.at(index) : nullptr;
+    return graph;
 }
 
-void SimulationManager::clearVehicles(QQmlListProperty<QObject> *list)
+QVariantMap SimulationManager::routeCacheStats() const
 {
-    SimulationManager *manager = qobject_cast<SimulationManager*>(list->object);
-    if (manager) {
-        qDeleteAll(manager->vehicles);
-        manager->vehicles.clear();
-        emit manager->vehiclesUpdated(); // Notify QML about the change
-    }
+    const RouteCache::Stats stats = graph.routeCacheStats();
+    QVariantMap map;
+    map["hits"] = stats.hits;
+    map["misses"] = stats.misses;
+    map["invalidations"] = stats.invalidations;
+    map["evictions"] = stats.evictions;
+    map["size"] = stats.size;
+    map["capacity"] = stats.capacity;
+    return map;
 }
 
-Graph& SimulationManager::getGraph()
-{
-    return graph;
-}
+QVector<int> SimulationManager::findConnectedVehicles(int startVehicle) const {
+    QVector<int> connected;
+    if (startVehicle < 0 || startVehicle >= store.size()) return connected;
 
-QList<Vehicle*> SimulationManager::findConnectedVehicles(Vehicle* startVehicle) {
-    QList<Vehicle*> connected;
-    if (!startVehicle) return connected;
+    // Index the current positions once; cells as wide as the longest range
+    // keep every query to a few cells around the sender
+    const int count = store.size();
+    QVector<PlanePoint> positions;
+    positions.reserve(count);
+    double maxRange = 0.0;
+    for (int i = 0; i < count; ++i) {
+        positions.append(store.position(i));
+        maxRange = qMax(maxRange, store.communicationRange(i));
+    }
+    SpatialGrid grid;
+    grid.build(positions, maxRange);
 
-    QSet<Vehicle*> visited;
-    QQueue<Vehicle*> queue;
+    QVector<bool> visited(count, false);
+    QQueue<int> queue;
 
     queue.enqueue(startVehicle);
-    visited.insert(startVehicle);
+    visited[startVehicle] = true;
 
+    QVector<int> candidates;
     while (!queue.isEmpty()) {
-        Vehicle* current = queue.dequeue();
+        const int current = queue.dequeue();
         connected.append(current);
 
-        for (Vehicle* other : vehicles) {
-            if (other == current || visited.contains(other)) continue;
-
-            QGeoCoordinate pos1(current->lat(), current->lon());
-            QGeoCoordinate pos2(other->lat(), other->lon());
-
-            double distance = pos1.distanceTo(pos2);
-
-            if (distance <= current->communicationRange()) {
-                queue.enqueue(other);
-                visited.insert(other);
-            }
+        // Every vehicle within range, in vehicle order, so the BFS order is unchanged
+        candidates.clear();
+        grid.query(positions[current], store.communicationRange(current), candidates);
+        for (int index : candidates) {
+            if (index == current || visited[index]) continue;
+            queue.enqueue(index);
+            visited[index] = true;
         }
     }
 
@@ -151,71 +182,43 @@ QList<Vehicle*> SimulationManager::findConnectedVehicles(Vehicle* startVehicle)
 }
 
 
-void SimulationManager::handleObstacle(Vehicle* reportingVehicle, const QPair<qint64, qint64>& blockedEdge) {
+void SimulationManager::handleObstacle(int reportingVehicle, quint32 blockedEdge) {
     // Find vehicles that are within the communication range of the reporting vehicle
-    QList<Vehicle*> connectedVehicles = findConnectedVehicles(reportingVehicle);
+    const QVector<int> connectedVehicles = findConnectedVehicles(reportingVehicle);
 
+    obstacleReports++;
+    // Links of this report stay on the map for linkDuration, whatever newer reports do
+    const double expiresAt = simulationClock.now() + linkDuration;
     QList<CommunicationLink> newLinks;
-    for (Vehicle* v : connectedVehicles) {
+    for (int v : connectedVehicles) {
         if (v != reportingVehicle) {
+            messagesDelivered++;
             // Only add links for vehicles receiving the message
-            newLinks.append({reportingVehicle->getCurrentPosition(), v->getCurrentPosition()});
-            v->receiveObstacle(blockedEdge); // Notify the vehicle about the obstacle
+            newLinks.append({store.latitude(reportingVehicle), store.longitude(reportingVehicle),
+                             store.latitude(v), store.longitude(v), expiresAt});
+            store.receiveObstacle(v, blockedEdge); // Notify the vehicle about the obstacle
         }
     }
 
-    // Update communication links for this obstacle report
-    m_communicationLinksModel->setCommunicationLinks(newLinks);
-    emit communicationLinksChanged();
-
-    // Clear communication links after a short period to simulate a transient network
-    QTimer::singleShot(1000, [this]() {
-        m_communicationLinksModel->setCommunicationLinks({});
+    if (!newLinks.isEmpty()) {
+        m_communicationLinksModel->appendLinks(newLinks);
         emit communicationLinksChanged();
-    });
+    }
 
     // Set messageReceived for the reporting vehicle
-    reportingVehicle->setMessageReceived(true);
+    store.setMessageReceived(reportingVehicle, true);
 }
 
 
 
 
 void SimulationManager::blockRandomEdge() {
-    QList<QPair<qint64, qint64>> availableEdges;
-    for (auto it = graph.getEdges().constBegin(); it != graph.getEdges().constEnd(); ++it) {
-        if (!graph.getBlockedEdges().contains(it.key())) {
-            if (it.key().first < it.key().second) {
-                availableEdges.append(it.key());
-            }
-        }
-    }
-
-    if (availableEdges.isEmpty()) {
+    const quint32 edge = obstacles.blockRandom(random, simulationClock.now(), obstacleDuration);
+    if (edge == CsrGraph::InvalidIndex) {
         qDebug() << "No more edges available to block.";
-        edgeBlockTimer.stop();
-        return;
-    }
-
-    int randomIndex = QRandomGenerator::global()->bounded(availableEdges.size());
-    QPair<qint64, qint64> edgeToBlock = availableEdges.at(randomIndex);
-
-    graph.blockEdge(edgeToBlock.first, edgeToBlock.second);
-    qDebug() << "Blocked edge between nodes" << edgeToBlock.first << "and" << edgeToBlock.second;
-
-    Edge* edge = graph.getEdges().value(edgeToBlock);
-    if (!edge) {
-        qWarning() << "Edge not found in graph for blocking.";
+        nextEdgeBlockTime = std::numeric_limits<double>::infinity();
         return;
     }
-
-    m_blockedEdgesModel->addBlockedEdgeWithTimestamp(edge->start->id, edge->end->id,
-                                                     edge->start->coordinate.latitude(),
-                                                     edge->start->coordinate.longitude(),
-                                                     edge->end->coordinate.latitude(),
-                                                     edge->end->coordinate.longitude(),
-                                                     QDateTime::currentDateTime());
-
     emit blockedEdgesChanged();
 }
 
@@ -232,42 +235,20 @@ void SimulationManager::placeRandomObstacles(int count) {
 
 void SimulationManager::unblockExpiredEdges()
 {
-    QDateTime now = QDateTime::currentDateTime();
-    QList<QPair<qint64, qint64>> edgesToUnblock;
-
-    QVariantList blockedEdgesVariant = m_blockedEdgesModel->getBlockedEdges();
-
-    for (const QVariant &var : blockedEdgesVariant) {
-        QVariantMap map = var.toMap();
-        qint64 startId = map.value("startId").toLongLong();
-        qint64 endId = map.value("endId").toLongLong();
-        QString blockedAtStr = map.value("blockedAt").toString();
-        QDateTime blockedAt = QDateTime::fromString(blockedAtStr, Qt::ISODate);
-
-        if (blockedAt.isValid() && blockedAt.msecsTo(now) >= obstacleDurationMs) {
-            edgesToUnblock.append(qMakePair(startId, endId));
-        }
-    }
-
-    for (const QPair<qint64, qint64> &edge : edgesToUnblock) {
-        graph.unblockEdge(edge.first, edge.second);
-        m_blockedEdgesModel->removeBlockedEdge(edge.first, edge.second);
-        qDebug() << "SimulationManager unblocked edge between nodes" << edge.first << "and" << edge.second;
-    }
-
-    if (!edgesToUnblock.isEmpty()) {
+    if (obstacles.expire(simulationClock.now()) > 0) {
         emit blockedEdgesChanged();
     }
 }
 
 QVariantList SimulationManager::getCommunicationLinks() const {
     QVariantList list;
-    for (const auto &pair : communicationLinks) {
+    for (int row = 0; row < m_communicationLinksModel->size(); ++row) {
+        const CommunicationLink &link = m_communicationLinksModel->link(row);
         QVariantMap map;
-        map["startLat"] = pair.first.latitude();
-        map["startLon"] = pair.first.longitude();
-        map["endLat"] = pair.second.latitude();
-        map["endLon"] = pair.second.longitude();
+        map["startLat"] = link.startLat;
+        map["startLon"] = link.startLon;
+        map["endLat"] = link.endLat;
+        map["endLon"] = link.endLon;
         list.append(map);
     }
     return list;
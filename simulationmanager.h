@@ -2,23 +2,35 @@
 #define SIMULATIONMANAGER_H
 
 #include <QObject>
-#include <QQmlListProperty>
 #include <QList>
-#include <QTimer>
-#include <QElapsedTimer>
-#include "vehicle.h"
+#include <QVariantMap>
+#include <QRandomGenerator>
+#include <QGeoRectangle>
+#include "vehiclestore.h"
 #include "graph.h"
+#include "routingservice.h"
+#include "spatialgrid.h"
+#include "simulationclock.h"
 #include "blockededgesmodel.h"
 #include "communicationlinksmodel.h"
+#include "viewportfiltermodel.h"
+#include "obstacleregistry.h"
 
 class SimulationManager : public QObject {
     Q_OBJECT
     Q_PROPERTY(QVariantList blockedEdges READ getBlockedEdges NOTIFY blockedEdgesChanged)
-    Q_PROPERTY(QQmlListProperty<QObject> vehiclesModel READ vehiclesModel NOTIFY vehiclesUpdated)
     Q_PROPERTY(CommunicationLinksModel* communicationLinksModel READ communicationLinksModel NOTIFY communicationLinksChanged)
+    Q_PROPERTY(ViewportFilterModel* visibleBlockedEdges READ visibleBlockedEdges CONSTANT)
 
 public:
     explicit SimulationManager(Graph &graph, QObject *parent = nullptr);
+
+    /**
+     * @brief SimulationManager
+     * Seeded run: obstacles and every vehicle's random stream derive from
+     * seed, so the same seed, graph and time step replay the same run.
+     */
+    SimulationManager(Graph &graph, quint64 seed, QObject *parent = nullptr);
     void addVehicle(int id, qint64 startNodeId);
     void setSpeedFactor(double factor);
     void clearVehicles();
@@ -29,23 +41,50 @@ public:
 
     QVariantList getCommunicationLinks() const;
 
-    // Expose vehiclesModel as QQmlListProperty for QML
-    QQmlListProperty<QObject> vehiclesModel();
+    // Simulation state of every vehicle; VehicleLayer draws it directly
+    VehicleStore& vehicleStore() { return store; }
+
+    /**
+     * @brief clock
+     * Drives the simulation; runs paced on wall time from construction.
+     * Obstacle lifetimes, message indicators and communication links all
+     * count simulated seconds from it.
+     */
+    SimulationClock& clock() { return simulationClock; }
+
+    // Totals since construction, for end-of-run reports
+    QVariantMap metrics() const;
 
     // Accessor for BlockedEdgesModel
     BlockedEdgesModel* blockedEdgesModel() const { return m_blockedEdgesModel; }
+
+    // Timed obstacles; the blocked edges model follows its events
+    ObstacleRegistry& obstacleRegistry() { return obstacles; }
     void placeRandomObstacles(int count);
 
-    // Method to handle obstacle reports from vehicles
-    void handleObstacle(Vehicle* reportingVehicle, const QPair<qint64, qint64> &blockedEdge);
+    // Method to handle obstacle reports from vehicles (VehicleStore indices)
+    void handleObstacle(int reportingVehicle, quint32 blockedEdge);
     CommunicationLinksModel* communicationLinksModel() const { return m_communicationLinksModel; }
 
+    // Route cache counters (hits, misses, invalidations, evictions, size, capacity)
+    Q_INVOKABLE QVariantMap routeCacheStats() const;
+
+    // Blocked edges crossing the viewport, for the map
+    ViewportFilterModel* visibleBlockedEdges() const { return m_visibleBlockedEdges; }
+
+    /**
+     * @brief setViewport
+     * Area shown on the map; the visible blocked edges model drops what
+     * lies outside. An invalid region shows everything.
+     */
+    Q_INVOKABLE void setViewport(const QGeoRectangle &region);
+
 
 public slots:
-    void updateVehicles();       // Called on simulation timer
     void blockRandomEdge();      // Blocks a random edge periodically
 
 private slots:
+    void advance(double deltaTime); // One clock step
     void unblockExpiredEdges();  // Unblocks edges after their duration
 
 signals:
@@ -55,27 +94,28 @@ signals:
     void communicationLinksChanged();
 
 private:
-    // Static functions for QQmlListProperty
-    static void appendVehicle(QQmlListProperty<QObject> *list, QObject *vehicle);
-    static qint64 vehicleCount(QQmlListProperty<QObject> *list);
-    static QObject* vehicleAt(QQmlListProperty<QObject> *list, qint64 index);
-    static void clearVehicles(QQmlListProperty<QObject> *list);
-
     // Helper method for vehicle communication
-    QList<Vehicle*> findConnectedVehicles(Vehicle* startVehicle);
+    QVector<int> findConnectedVehicles(int startVehicle) const;
 
     Graph &graph;
-    QList<Vehicle*> vehicles;
-    QTimer simulationTimer;
-    QTimer edgeBlockTimer;     // Timer for blocking edges
-    double speedFactor = 1.0;
-    QElapsedTimer elapsedTimer;
-    QTimer unblockTimer;       // Timer to check for edges to unblock
-    const int obstacleDurationMs = 100000;
-    QList<QPair<QGeoCoordinate, QGeoCoordinate>> communicationLinks;
+    RoutingService routingService;
+    VehicleStore store;
+    SimulationClock simulationClock;
+    QRandomGenerator random; // Obstacle placement
+    ObstacleRegistry obstacles;
+
+    // Schedules, in simulated seconds
+    double nextEdgeBlockTime;  // A new obstacle every edgeBlockInterval
+    static constexpr double edgeBlockInterval = 30.0;
+    static constexpr double obstacleDuration = 100.0;
+    static constexpr double linkDuration = 1.0;
+
+    int obstacleReports = 0;
+    qint64 messagesDelivered = 0;
 
     BlockedEdgesModel *m_blockedEdgesModel = new BlockedEdgesModel(this);
     CommunicationLinksModel *m_communicationLinksModel = new CommunicationLinksModel(this);
+    ViewportFilterModel *m_visibleBlockedEdges = new ViewportFilterModel(this);
 
 };
 
@@ -0,0 +1,70 @@
+// spatialgrid.cpp
+#include "spatialgrid.h"
+#include <algorithm>
+#include <cmath>
+
+void SpatialGrid::build(const QVector<PlanePoint> &positions, double size)
+{
+    points.clear();
+    sortedPoints.clear();
+    cells.clear();
+    cellSize = qMax(size, 1.0);
+    if (positions.isEmpty()) {
+        return;
+    }
+
+    points = positions;
+    QVector<QPair<quint64, int>> keyed;
+    keyed.reserve(positions.size());
+    for (int i = 0; i < positions.size(); ++i) {
+        keyed.append(qMakePair(cellKey(cellCoordinate(positions[i].x), cellCoordinate(positions[i].y)), i));
+    }
+
+    // Sorting by (cell, index) keeps each cell's points in ascending order
+    std::sort(keyed.begin(), keyed.end());
+    sortedPoints.reserve(keyed.size());
+    for (int i = 0; i < keyed.size(); ++i) {
+        if (i == 0 || keyed[i].first != keyed[i - 1].first) {
+            cells.insert(keyed[i].first, qMakePair(i, i));
+        }
+        cells[keyed[i].first].second = i + 1;
+        sortedPoints.append(keyed[i].second);
+    }
+}
+
+qint32 SpatialGrid::cellCoordinate(double metres) const
+{
+    return qint32(std::floor(metres / cellSize));
+}
+
+void SpatialGrid::query(const PlanePoint &center, double radius, QVector<int> &out) const
+{
+    if (points.isEmpty()) {
+        return;
+    }
+
+    const double radiusSquared = radius * radius;
+    const qint32 minX = cellCoordinate(center.x - radius);
+    const qint32 maxX = cellCoordinate(center.x + radius);
+    const qint32 minY = cellCoordinate(center.y - radius);
+    const qint32 maxY = cellCoordinate(center.y + radius);
+
+    const int first = out.size();
+    for (qint32 x = minX; x <= maxX; ++x) {
+        for (qint32 y = minY; y <= maxY; ++y) {
+            auto cell = cells.constFind(cellKey(x, y));
+            if (cell == cells.constEnd()) {
+                continue;
+            }
+            for (int i = cell.value().first; i < cell.value().second; ++i) {
+                const int index = sortedPoints[i];
+                const double dx = points[index].x - center.x;
+                const double dy = points[index].y - center.y;
+                if (dx * dx + dy * dy <= radiusSquared) {
+                    out.append(index);
+                }
+            }
+        }
+    }
+    std::sort(out.begin() + first, out.end());
+}
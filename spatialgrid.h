@@ -0,0 +1,47 @@
+// spatialgrid.h
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <QHash>
+#include <QVector>
+#include "localprojection.h"
+
+/**
+ * @brief The SpatialGrid class
+ * Uniform grid over points of the local plane, for range queries between
+ * vehicles.
+ *
+ * Points are bucketed into square cells; query() visits only the cells
+ * overlapping the radius and returns the points within it.
+ */
+class SpatialGrid {
+public:
+    SpatialGrid() = default;
+
+    /**
+     * @brief build
+     * Indexes positions (point i is index i) with cells of cellSize metres.
+     */
+    void build(const QVector<PlanePoint> &positions, double cellSize);
+
+    bool isEmpty() const { return points.isEmpty(); }
+
+    /**
+     * @brief query
+     * Appends to out, in ascending order, the indices of points within
+     * radius metres of center.
+     */
+    void query(const PlanePoint &center, double radius, QVector<int> &out) const;
+
+private:
+    static quint64 cellKey(qint32 x, qint32 y) { return (quint64(quint32(x)) << 32) | quint32(y); }
+    qint32 cellCoordinate(double metres) const;
+
+    double cellSize = 1.0;
+
+    QVector<PlanePoint> points;       // Positions by point index
+    QVector<int> sortedPoints;        // Point indices grouped by cell
+    QHash<quint64, QPair<int, int>> cells; // Cell -> [begin, end) in sortedPoints
+};
+
+#endif // SPATIALGRID_H
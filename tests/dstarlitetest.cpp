@@ -0,0 +1,113 @@
+// dstarlitetest.cpp
+//
+// D* Lite against Graph::findPath on a small grid: every start/goal pair
+// must get the same route length, before and after an edge of the route is
+// blocked. Exits non-zero on the first difference.
+
+#include <QDebug>
+#include <QGeoCoordinate>
+#include "dstarlite.h"
+#include "graph.h"
+
+namespace {
+
+const int GridSize = 5;
+const double Spacing = 0.001; // Degrees between neighbouring nodes
+
+qint64 nodeId(int x, int y)
+{
+    return 1 + y * GridSize + x;
+}
+
+double routeLength(const QList<Edge*> &route)
+{
+    double length = 0.0;
+    for (const Edge *edge : route) {
+        length += edge->length;
+    }
+    return length;
+}
+
+// Roads are a little longer than the straight line between their ends, and
+// not all by the same factor, so routes of equal hop count differ
+void buildGrid(Graph &graph)
+{
+    for (int y = 0; y < GridSize; ++y) {
+        for (int x = 0; x < GridSize; ++x) {
+            graph.addNode(nodeId(x, y), 47.75 + y * Spacing, 7.33 + x * Spacing);
+        }
+    }
+    auto connect = [&graph](qint64 a, qint64 b, double detour) {
+        const double straight = graph.coordinate(a).distanceTo(graph.coordinate(b));
+        graph.addEdge(a, b, straight * detour);
+    };
+    for (int y = 0; y < GridSize; ++y) {
+        for (int x = 0; x < GridSize; ++x) {
+            const double detour = 1.0 + 0.1 * ((x * 7 + y * 3) % 5);
+            if (x + 1 < GridSize) {
+                connect(nodeId(x, y), nodeId(x + 1, y), detour);
+            }
+            if (y + 1 < GridSize) {
+                connect(nodeId(x, y), nodeId(x, y + 1), 2.5 - detour);
+            }
+        }
+    }
+    graph.freeze();
+}
+
+bool sameLength(const QList<Edge*> &planned, const QList<Edge*> &expected)
+{
+    return qAbs(routeLength(planned) - routeLength(expected)) <= 1e-6 * qMax(1.0, routeLength(expected));
+}
+
+} // namespace
+
+int main()
+{
+    Graph graph;
+    buildGrid(graph);
+    const CsrGraph &csr = graph.csr();
+
+    int failures = 0;
+    for (int start = 0; start < graph.nodeCount(); ++start) {
+        for (int goal = 0; goal < graph.nodeCount(); ++goal) {
+            if (start == goal) {
+                continue;
+            }
+            const qint64 startId = graph.nodeIdAt(start);
+            const qint64 goalId = graph.nodeIdAt(goal);
+
+            DStarLite planner(graph);
+            planner.reset(csr.indexOf(goalId));
+            QList<Edge*> planned;
+            const QList<Edge*> expected = graph.findPath(startId, goalId);
+            if (!planner.replan(csr.indexOf(startId), planned) || !sameLength(planned, expected)) {
+                qWarning() << "First plan" << startId << "->" << goalId << ":" << routeLength(planned)
+                           << "m, findPath" << routeLength(expected) << "m";
+                failures++;
+                continue;
+            }
+
+            // Block the middle edge of the route and repair the search
+            Edge *blocked = expected[expected.size() / 2];
+            graph.blockEdge(blocked->start->id, blocked->end->id);
+            planner.notifyEdgeChanged(blocked->index);
+            const QList<Edge*> detour = graph.findPath(startId, goalId);
+            const bool reachable = !detour.isEmpty();
+            if (planner.replan(csr.indexOf(startId), planned) != reachable || !sameLength(planned, detour)) {
+                qWarning() << "Replan" << startId << "->" << goalId << "around" << blocked->start->id
+                           << blocked->end->id << ":" << routeLength(planned) << "m, findPath"
+                           << routeLength(detour) << "m";
+                failures++;
+            }
+            graph.unblockEdge(blocked->start->id, blocked->end->id);
+        }
+    }
+
+    if (failures > 0) {
+        qWarning() << failures << "D* Lite routes differ from findPath.";
+        return 1;
+    }
+    qInfo() << "D* Lite matches findPath on every pair of a" << GridSize << "x" << GridSize << "grid.";
+    return 0;
+}
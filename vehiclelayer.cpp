@@ -0,0 +1,440 @@
+// vehiclelayer.cpp
+#include "vehiclelayer.h"
+#include <QColor>
+#include <QDebug>
+#include <QImage>
+#include <QImageReader>
+#include <QPainter>
+#include <QPointF>
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGSimpleTextureNode>
+#include <QSGTextureMaterial>
+#include <QSGVertexColorMaterial>
+#include <QtMath>
+#include <cmath>
+#include <memory>
+
+namespace {
+
+// Subtree of the layer: range discs below, then the density texture (only
+// while zoomed out), communication links, and icons on top. The atlas
+// texture is owned here because QSGTextureMaterial does not own its texture.
+class VehicleNode : public QSGNode {
+public:
+    QSGGeometryNode *discs = nullptr;
+    QSGSimpleTextureNode *heatmap = nullptr;
+    QSGGeometryNode *links = nullptr;
+    QSGGeometryNode *icons = nullptr;
+    std::unique_ptr<QSGTexture> atlas;
+
+    // Bins behind the current heatmap texture, to skip unchanged uploads
+    QVector<float> heatmapCounts;
+    int heatmapColumns = 0;
+};
+
+// Screen position of a vehicle that is at least partly inside the item
+struct Mark {
+    float x;
+    float y;
+    float radius; // Range disc, in pixels
+    int vehicle;
+};
+
+// Rim directions of a range disc
+const int DiscSegments = 24;
+
+struct UnitCircle {
+    float x[DiscSegments];
+    float y[DiscSegments];
+
+    UnitCircle() {
+        for (int s = 0; s < DiscSegments; ++s) {
+            x[s] = float(std::cos(2.0 * M_PI * s / DiscSegments));
+            y[s] = float(std::sin(2.0 * M_PI * s / DiscSegments));
+        }
+    }
+};
+
+// Normal car in the left half, "message received" car in the right half
+QImage renderAtlas(int cell)
+{
+    QImage atlas(cell * 2, cell, QImage::Format_ARGB32_Premultiplied);
+    atlas.fill(Qt::transparent);
+    QPainter painter(&atlas);
+    const QString sources[] = {QStringLiteral(":/images/car_icon.svg"), QStringLiteral(":/images/car_green.svg")};
+    for (int i = 0; i < 2; ++i) {
+        QImageReader reader(sources[i]);
+        reader.setScaledSize(QSize(cell, cell));
+        const QImage icon = reader.read();
+        if (icon.isNull()) {
+            qWarning() << "Cannot load vehicle icon" << sources[i] << ":" << reader.errorString();
+            continue;
+        }
+        painter.drawImage(i * cell, 0, icon);
+    }
+    return atlas;
+}
+
+// Density ramp from sparse (blue) through yellow to dense (red), t in [0, 1]
+QRgb heatColor(float t)
+{
+    const float low = qMin(t * 2.0f, 1.0f);
+    const float high = qMax(t * 2.0f - 1.0f, 0.0f);
+    const int red = qRound(255 * low);
+    const int green = qRound(255 * (low - 0.8f * high));
+    const int blue = qRound(255 * (1.0f - low));
+    const int alpha = qRound(255 * (0.35f + 0.4f * t));
+    return qPremultiply(qRgba(red, green, blue, alpha));
+}
+
+// Vehicles per bin of cell logical pixels, row by row
+QVector<float> binVehicles(const QVector<Mark> &marks, int columns, int rows, float cell)
+{
+    QVector<float> counts(columns * rows, 0.0f);
+    for (const Mark &mark : marks) {
+        const int column = int(std::floor(mark.x / cell));
+        const int row = int(std::floor(mark.y / cell));
+        if (column >= 0 && column < columns && row >= 0 && row < rows) {
+            counts[row * columns + column] += 1.0f;
+        }
+    }
+    return counts;
+}
+
+// One pixel per bin, counts spread over the 3x3 neighbourhood and scaled to
+// the densest bin. The square root keeps sparse areas visible next to a
+// dense centre.
+QImage renderHeatmap(const QVector<float> &counts, int columns, int rows)
+{
+    QVector<float> density(columns * rows, 0.0f);
+    float peak = 0.0f;
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            float sum = 0.0f;
+            for (int r = qMax(row - 1, 0); r <= qMin(row + 1, rows - 1); ++r) {
+                for (int c = qMax(column - 1, 0); c <= qMin(column + 1, columns - 1); ++c) {
+                    sum += counts[r * columns + c];
+                }
+            }
+            density[row * columns + column] = sum;
+            peak = qMax(peak, sum);
+        }
+    }
+
+    QImage image(columns, rows, QImage::Format_ARGB32_Premultiplied);
+    for (int row = 0; row < rows; ++row) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(row));
+        for (int column = 0; column < columns; ++column) {
+            const float value = density[row * columns + column];
+            line[column] = value > 0.0f ? heatColor(std::sqrt(value / peak)) : 0;
+        }
+    }
+    return image;
+}
+
+// Web Mercator, as a fraction of the world width from the antimeridian and the north edge
+double mercatorX(double longitude)
+{
+    return (longitude + 180.0) / 360.0;
+}
+
+double mercatorY(double latitude)
+{
+    const double phi = qDegreesToRadians(latitude);
+    return 0.5 - std::log(std::tan(M_PI / 4.0 + phi / 2.0)) / (2.0 * M_PI);
+}
+
+} // namespace
+
+VehicleLayer::VehicleLayer(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+void VehicleLayer::setSimulation(SimulationManager *simulation)
+{
+    if (simulationManager == simulation) {
+        return;
+    }
+    if (simulationManager) {
+        disconnect(simulationManager, nullptr, this, nullptr);
+    }
+    simulationManager = simulation;
+    if (simulationManager) {
+        // One repaint per simulation frame, whatever the number of vehicles
+        connect(simulationManager, &SimulationManager::updated, this, &QQuickItem::update);
+        connect(simulationManager, &SimulationManager::vehiclesUpdated, this, &QQuickItem::update);
+        connect(simulationManager, &SimulationManager::communicationLinksChanged, this, &QQuickItem::update);
+    }
+    emit simulationChanged();
+    update();
+}
+
+void VehicleLayer::setCenter(const QGeoCoordinate &center)
+{
+    if (mapCenter == center) {
+        return;
+    }
+    mapCenter = center;
+    emit centerChanged();
+    update();
+}
+
+void VehicleLayer::setZoomLevel(double zoomLevel)
+{
+    if (qFuzzyCompare(zoom, zoomLevel)) {
+        return;
+    }
+    zoom = zoomLevel;
+    emit zoomLevelChanged();
+    update();
+}
+
+void VehicleLayer::setHeatmapZoom(double zoomLevel)
+{
+    if (qFuzzyCompare(densityZoom, zoomLevel)) {
+        return;
+    }
+    densityZoom = zoomLevel;
+    emit heatmapZoomChanged();
+    update();
+}
+
+void VehicleLayer::updateColors()
+{
+    const VehicleStore &store = simulationManager->vehicleStore();
+    const int count = store.size();
+    colorNames.resize(count);
+    colors.resize(count);
+    for (int i = 0; i < count; ++i) {
+        const QString &name = store.color(i);
+        if (colorNames[i] != name) {
+            colorNames[i] = name;
+            colors[i] = QColor(name).rgb();
+        }
+    }
+}
+
+QSGNode *VehicleLayer::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    VehicleNode *root = static_cast<VehicleNode*>(oldNode);
+    if (!simulationManager || !mapCenter.isValid() || width() <= 0.0 || height() <= 0.0) {
+        delete root;
+        return nullptr;
+    }
+
+    if (!root) {
+        root = new VehicleNode;
+
+        QSGGeometry *discGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(),
+                                                    0, 0, QSGGeometry::UnsignedIntType);
+        discGeometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        discGeometry->setVertexDataPattern(QSGGeometry::StreamPattern);
+        discGeometry->setIndexDataPattern(QSGGeometry::StreamPattern);
+        root->discs = new QSGGeometryNode;
+        root->discs->setGeometry(discGeometry);
+        root->discs->setMaterial(new QSGVertexColorMaterial);
+        root->discs->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+        root->appendChildNode(root->discs);
+
+        QSGGeometry *linkGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(),
+                                                    0, 0, QSGGeometry::UnsignedIntType);
+        linkGeometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        linkGeometry->setVertexDataPattern(QSGGeometry::StreamPattern);
+        linkGeometry->setIndexDataPattern(QSGGeometry::StreamPattern);
+        QSGFlatColorMaterial *linkMaterial = new QSGFlatColorMaterial;
+        linkMaterial->setColor(QColor(QStringLiteral("green")));
+        root->links = new QSGGeometryNode;
+        root->links->setGeometry(linkGeometry);
+        root->links->setMaterial(linkMaterial);
+        root->links->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+        root->appendChildNode(root->links);
+
+        const int cell = qCeil(IconSize * window()->effectiveDevicePixelRatio());
+        root->atlas.reset(window()->createTextureFromImage(renderAtlas(cell)));
+        QSGTextureMaterial *iconMaterial = new QSGTextureMaterial;
+        iconMaterial->setTexture(root->atlas.get());
+        iconMaterial->setFiltering(QSGTexture::Linear);
+
+        QSGGeometry *iconGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(),
+                                                    0, 0, QSGGeometry::UnsignedIntType);
+        iconGeometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        iconGeometry->setVertexDataPattern(QSGGeometry::StreamPattern);
+        iconGeometry->setIndexDataPattern(QSGGeometry::StreamPattern);
+        root->icons = new QSGGeometryNode;
+        root->icons->setGeometry(iconGeometry);
+        root->icons->setMaterial(iconMaterial);
+        root->icons->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+        root->appendChildNode(root->icons);
+    }
+
+    // The GUI thread is blocked while the scene graph syncs, so the store
+    // can be read in place
+    const VehicleStore &store = simulationManager->vehicleStore();
+    const LocalProjection &projection = simulationManager->getGraph().projection();
+    const QVector<double> &xs = store.xData();
+    const QVector<double> &ys = store.yData();
+    const int count = store.size();
+    updateColors();
+
+    const double worldSize = 256.0 * std::pow(2.0, zoom);
+    const double left = mercatorX(mapCenter.longitude()) * worldSize - width() / 2.0;
+    const double top = mercatorY(mapCenter.latitude()) * worldSize - height() / 2.0;
+    const double metersPerTurn = 2.0 * M_PI * LocalProjection::EarthRadius;
+    const double halfIcon = IconSize / 2.0;
+
+    QVector<Mark> marks;
+    marks.reserve(count);
+    int discCount = 0;
+    for (int i = 0; i < count; ++i) {
+        const PlanePoint position{xs[i], ys[i]};
+        const double latitude = projection.latitude(position);
+        const double x = mercatorX(projection.longitude(position)) * worldSize - left;
+        const double y = mercatorY(latitude) * worldSize - top;
+        const double radius = store.communicationRange(i) * worldSize
+                              / (metersPerTurn * std::cos(qDegreesToRadians(latitude)));
+        const double reach = qMax(radius, halfIcon);
+        if (x + reach < 0.0 || y + reach < 0.0 || x - reach > width() || y - reach > height()) {
+            continue;
+        }
+        marks.append({float(x), float(y), float(radius), i});
+        if (float(radius) >= 1.0f) {
+            discCount++;
+        }
+    }
+
+    // Communication links: one quad per on-screen link, LinkWidth wide
+    const CommunicationLinksModel *linksModel = simulationManager->communicationLinksModel();
+    QVector<QPointF> segments;
+    segments.reserve(linksModel->size() * 2);
+    for (int row = 0; row < linksModel->size(); ++row) {
+        const CommunicationLink &link = linksModel->link(row);
+        const QPointF start(mercatorX(link.startLon) * worldSize - left, mercatorY(link.startLat) * worldSize - top);
+        const QPointF end(mercatorX(link.endLon) * worldSize - left, mercatorY(link.endLat) * worldSize - top);
+        if (qMax(start.x(), end.x()) < 0.0 || qMax(start.y(), end.y()) < 0.0
+            || qMin(start.x(), end.x()) > width() || qMin(start.y(), end.y()) > height()) {
+            continue;
+        }
+        segments.append(start);
+        segments.append(end);
+    }
+
+    const int linkCount = int(segments.size()) / 2;
+    QSGGeometry *linkGeometry = root->links->geometry();
+    linkGeometry->allocate(linkCount * 4, linkCount * 6);
+    QSGGeometry::Point2D *linkVertices = linkGeometry->vertexDataAsPoint2D();
+    quint32 *linkIndices = linkGeometry->indexDataAsUInt();
+    quint32 base = 0;
+    for (int i = 0; i < linkCount; ++i) {
+        const QPointF &start = segments[2 * i];
+        const QPointF &end = segments[2 * i + 1];
+        const double length = std::hypot(end.x() - start.x(), end.y() - start.y());
+        // Half the width along the normal; a degenerate link collapses to nothing
+        const double scale = length > 0.0 ? LinkWidth / (2.0 * length) : 0.0;
+        const float nx = float(-(end.y() - start.y()) * scale);
+        const float ny = float((end.x() - start.x()) * scale);
+        linkVertices[0].set(float(start.x()) + nx, float(start.y()) + ny);
+        linkVertices[1].set(float(start.x()) - nx, float(start.y()) - ny);
+        linkVertices[2].set(float(end.x()) + nx, float(end.y()) + ny);
+        linkVertices[3].set(float(end.x()) - nx, float(end.y()) - ny);
+        linkVertices += 4;
+        const quint32 quad[] = {base, base + 1, base + 2, base + 2, base + 1, base + 3};
+        for (quint32 index : quad) {
+            *linkIndices++ = index;
+        }
+        base += 4;
+    }
+    root->links->markDirty(QSGNode::DirtyGeometry);
+
+    if (zoom < densityZoom) {
+        root->discs->geometry()->allocate(0, 0);
+        root->discs->markDirty(QSGNode::DirtyGeometry);
+        root->icons->geometry()->allocate(0, 0);
+        root->icons->markDirty(QSGNode::DirtyGeometry);
+
+        if (!root->heatmap) {
+            root->heatmap = new QSGSimpleTextureNode;
+            root->heatmap->setOwnsTexture(true);
+            root->heatmap->setFiltering(QSGTexture::Linear);
+            // Under the links, which stay readable when zoomed out
+            root->insertChildNodeBefore(root->heatmap, root->links);
+        }
+        // A few thousand bins, whatever the number of vehicles. The texture
+        // is only rebuilt when a bin count or the grid changes.
+        const int columns = qCeil(width() / HeatmapCell);
+        const int rows = qCeil(height() / HeatmapCell);
+        QVector<float> counts = binVehicles(marks, columns, rows, float(HeatmapCell));
+        if (!root->heatmap->texture() || columns != root->heatmapColumns || counts != root->heatmapCounts) {
+            root->heatmap->setTexture(window()->createTextureFromImage(renderHeatmap(counts, columns, rows)));
+            root->heatmap->setRect(QRectF(0.0, 0.0, columns * HeatmapCell, rows * HeatmapCell));
+            root->heatmapCounts = std::move(counts);
+            root->heatmapColumns = columns;
+        }
+        return root;
+    }
+    if (root->heatmap) {
+        root->removeChildNode(root->heatmap);
+        delete root->heatmap;
+        root->heatmap = nullptr;
+        root->heatmapCounts.clear();
+        root->heatmapColumns = 0;
+    }
+
+    // Range discs: a fan from the vehicle colour at the centre to transparent at the rim
+    static const UnitCircle rim;
+
+    QSGGeometry *discGeometry = root->discs->geometry();
+    discGeometry->allocate(discCount * (DiscSegments + 1), discCount * DiscSegments * 3);
+    QSGGeometry::ColoredPoint2D *discVertices = discGeometry->vertexDataAsColoredPoint2D();
+    quint32 *discIndices = discGeometry->indexDataAsUInt();
+    const int alpha = qRound(255 * DiscOpacity);
+    base = 0;
+    for (const Mark &mark : std::as_const(marks)) {
+        if (mark.radius < 1.0f) {
+            continue;
+        }
+        const QRgb color = colors[mark.vehicle];
+        // Premultiplied, as the vertex colour material expects
+        discVertices[0].set(mark.x, mark.y, uchar(qRed(color) * alpha / 255),
+                            uchar(qGreen(color) * alpha / 255), uchar(qBlue(color) * alpha / 255), uchar(alpha));
+        for (int s = 0; s < DiscSegments; ++s) {
+            discVertices[s + 1].set(mark.x + mark.radius * rim.x[s], mark.y + mark.radius * rim.y[s], 0, 0, 0, 0);
+            *discIndices++ = base;
+            *discIndices++ = base + 1 + quint32(s);
+            *discIndices++ = base + 1 + quint32((s + 1) % DiscSegments);
+        }
+        discVertices += DiscSegments + 1;
+        base += DiscSegments + 1;
+    }
+    root->discs->markDirty(QSGNode::DirtyGeometry);
+
+    // Icons: one quad per vehicle, the atlas half picked by the message flag
+    QSGGeometry *iconGeometry = root->icons->geometry();
+    iconGeometry->allocate(int(marks.size()) * 4, int(marks.size()) * 6);
+    QSGGeometry::TexturedPoint2D *iconVertices = iconGeometry->vertexDataAsTexturedPoint2D();
+    quint32 *iconIndices = iconGeometry->indexDataAsUInt();
+    base = 0;
+    for (const Mark &mark : std::as_const(marks)) {
+        const float u = store.messageReceived(mark.vehicle) ? 0.5f : 0.0f;
+        const float x0 = mark.x - float(halfIcon);
+        const float y0 = mark.y - float(halfIcon);
+        const float x1 = mark.x + float(halfIcon);
+        const float y1 = mark.y + float(halfIcon);
+        iconVertices[0].set(x0, y0, u, 0.0f);
+        iconVertices[1].set(x1, y0, u + 0.5f, 0.0f);
+        iconVertices[2].set(x0, y1, u, 1.0f);
+        iconVertices[3].set(x1, y1, u + 0.5f, 1.0f);
+        iconVertices += 4;
+        const quint32 quad[] = {base, base + 1, base + 2, base + 2, base + 1, base + 3};
+        for (quint32 index : quad) {
+            *iconIndices++ = index;
+        }
+        base += 4;
+    }
+    root->icons->markDirty(QSGNode::DirtyGeometry);
+
+    return root;
+}
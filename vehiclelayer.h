@@ -0,0 +1,82 @@
+// vehiclelayer.h
+#ifndef VEHICLELAYER_H
+#define VEHICLELAYER_H
+
+#include <QQuickItem>
+#include <QGeoCoordinate>
+#include <QPointer>
+#include <QRgb>
+#include <QString>
+#include <QVector>
+#include "simulationmanager.h"
+
+/**
+ * @brief The VehicleLayer class
+ * Draws every vehicle of a simulation, icon and communication range, and
+ * the live communication links as three batched scene-graph nodes instead
+ * of one QML delegate per vehicle or link.
+ *
+ * The layer lies over the Map and follows its center and zoomLevel.
+ * Positions are read straight from the VehicleStore arrays when the frame is
+ * synchronised and projected with the Web Mercator tiling of the OSM plugin
+ * (256 px tiles, no bearing or tilt). Range discs are triangle fans fading
+ * from the vehicle colour to transparent; icons are textured quads from one
+ * atlas holding the normal and the "message received" car. Vehicles whose
+ * disc lies outside the item are skipped.
+ *
+ * Below heatmapZoom, single cars are too small to tell apart: the on-screen
+ * vehicles are counted in HeatmapCell pixel bins instead, and the blurred
+ * counts are drawn as one colour-ramped density texture under the links;
+ * it is only uploaded again when a bin count changes.
+ */
+class VehicleLayer : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(SimulationManager *simulation READ simulation WRITE setSimulation NOTIFY simulationChanged)
+    Q_PROPERTY(QGeoCoordinate center READ center WRITE setCenter NOTIFY centerChanged)
+    Q_PROPERTY(double zoomLevel READ zoomLevel WRITE setZoomLevel NOTIFY zoomLevelChanged)
+    Q_PROPERTY(double heatmapZoom READ heatmapZoom WRITE setHeatmapZoom NOTIFY heatmapZoomChanged)
+
+public:
+    explicit VehicleLayer(QQuickItem *parent = nullptr);
+
+    SimulationManager *simulation() const { return simulationManager; }
+    void setSimulation(SimulationManager *simulation);
+
+    QGeoCoordinate center() const { return mapCenter; }
+    void setCenter(const QGeoCoordinate &center);
+
+    double zoomLevel() const { return zoom; }
+    void setZoomLevel(double zoomLevel);
+
+    double heatmapZoom() const { return densityZoom; }
+    void setHeatmapZoom(double zoomLevel);
+
+signals:
+    void simulationChanged();
+    void centerChanged();
+    void zoomLevelChanged();
+    void heatmapZoomChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+
+private:
+    static constexpr double IconSize = 32.0;     // Logical pixels
+    static constexpr double DiscOpacity = 0.03;  // At the centre of a range disc
+    static constexpr double HeatmapCell = 8.0;   // Logical pixels per density bin
+    static constexpr double LinkWidth = 2.0;     // Logical pixels
+
+    // Parses the store's colour names once per vehicle, not once per frame
+    void updateColors();
+
+    QPointer<SimulationManager> simulationManager;
+    QGeoCoordinate mapCenter;
+    double zoom = 14.0;
+    double densityZoom = 13.0;
+
+    QVector<QString> colorNames;
+    QVector<QRgb> colors;
+};
+
+#endif // VEHICLELAYER_H
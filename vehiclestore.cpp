@@ -0,0 +1,631 @@
+// vehiclestore.cpp
+
+#include "vehiclestore.h"
+#include "routingservice.h"
+#include <QRandomGenerator>
+#include <QSemaphore>
+#include <QDebug>
+#include <QtMath>
+
+static const int MAX_START_RETRIES = 50;
+static const double MIN_SPEED = 30.0; // km/h
+static const double MAX_SPEED = 50.0; // km/h
+static const double PUISSANCE_MIN = 80.0; // in Watts
+static const double PUISSANCE_MAX = 120.0; // in Watts
+static const double FREQUENCE_MIN = 3.0 * pow(10, 9); // 3 GHz
+static const double FREQUENCE_MAX = 26.0 * pow(10, 9); // 26 GHz
+static const double LIGHT_SPEED = 3.0 * pow(10, 8); // m/s
+static const double MESSAGE_DURATION = 10.0; // Simulated seconds the message indicator stays on
+static const int MIN_CHUNK_SIZE = 512; // Below this, spreading the kinematic phase costs more than it saves
+
+// splitmix64: one 64-bit word of state per vehicle, good enough streams
+static quint64 nextRandom(quint64 &state)
+{
+    quint64 z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static QString colorForFrequency(double fc)
+{
+    // Map frequency to hue: normalize frequency to [0, 360)
+    double hue = 360.0 * (fc - FREQUENCE_MIN) / (FREQUENCE_MAX - FREQUENCE_MIN);
+    hue = fmod(hue, 360.0);
+
+    // Full saturation and value keep the color bright; with both at 1 the
+    // HSV to RGB conversion reduces to a ramp inside the hue sector
+    const double sector = hue / 60.0;
+    const double rising = sector - std::floor(sector);
+    const double falling = 1.0 - rising;
+    double red = 0.0, green = 0.0, blue = 0.0;
+    switch (int(sector) % 6) {
+    case 0: red = 1.0;     green = rising;  break;
+    case 1: red = falling; green = 1.0;     break;
+    case 2: green = 1.0;   blue = rising;   break;
+    case 3: green = falling; blue = 1.0;    break;
+    case 4: red = rising;  blue = 1.0;      break;
+    default: red = 1.0;    blue = falling;  break;
+    }
+
+    return QString("#%1%2%3")
+        .arg(qRound(red * 255), 2, 16, QLatin1Char('0'))
+        .arg(qRound(green * 255), 2, 16, QLatin1Char('0'))
+        .arg(qRound(blue * 255), 2, 16, QLatin1Char('0')); // e.g., "#ff00ff"
+}
+
+VehicleStore::VehicleStore(Graph &graph)
+    : graph(graph),
+    baseSeed(QRandomGenerator::global()->generate64())
+{
+}
+
+VehicleStore::~VehicleStore()
+{
+    clear();
+}
+
+int VehicleStore::add(int id, qint64 startNodeId)
+{
+    const int index = ids.size();
+    ids.append(id);
+    xs.append(0.0);
+    ys.append(0.0);
+    speeds.append(0.0);
+    distances.append(0.0);
+    segmentStarts.append(0.0);
+    segmentEnds.append(0.0);
+    originXs.append(0.0);
+    originYs.append(0.0);
+    stepXs.append(0.0);
+    stepYs.append(0.0);
+    segmentEdges.append(nullptr);
+    segments.append(0);
+    ranges.append(0.0);
+    messageTimes.append(0.0);
+    odometers.append(0.0);
+    flags.append(0);
+    quint64 randomState = baseSeed ^ (quint64(quint32(id)) * 0xd1b54a32d192ed03ULL);
+    nextRandom(randomState); // Decorrelate neighbouring ids
+    randomStates.append(randomState);
+    Agent *agent = new Agent(graph);
+    agent->currentNodeId = startNodeId;
+    agents.append(agent);
+
+    /*
+    Pt = entre 50 et 150 W
+    Gt = 10
+    Gr = 10
+    fc = entre 3 et 26 GHz
+    Pr_min = 1 microWatt
+    Chaque fréquence correspond à une couleur
+    */
+
+    // Puissance transmise
+    const double Pt = randomReal(index, PUISSANCE_MAX - PUISSANCE_MIN) + PUISSANCE_MIN;
+    // Gain de transmission
+    const double Gt = 10.0;
+    // Gain de reception
+    const double Gr = 10.0;
+    // Fréquence entre 3 et 26 GHz
+    const double fc = randomReal(index, FREQUENCE_MAX - FREQUENCE_MIN) + FREQUENCE_MIN;
+    const double lambda = LIGHT_SPEED / fc;
+    // Puissance de reception minimale
+    const double Pr_min = 0.000001; // 1 microWatt
+
+    ranges[index] = sqrt(Pt * Gt * Gr / Pr_min) * lambda / (4 * M_PI);
+
+    // 1) Random speed between MIN_SPEED and MAX_SPEED, stored in m/s
+    const double speedKmh = randomReal(index, MAX_SPEED - MIN_SPEED) + MIN_SPEED;
+    speeds[index] = speedKmh * (1000.0 / 3600.0);
+
+    // 2) Assign a color based on frequency
+    agent->color = colorForFrequency(fc);
+
+    // 3) Attempt to pick a valid path
+    if (!graph.hasNode(agent->currentNodeId)) {
+        if (graph.nodeCount() > 0) {
+            agent->currentNodeId = graph.nodeIdAt(
+                randomIndex(index, graph.nodeCount())
+                );
+        } else {
+            qWarning() << "Graph has no nodes.";
+            return index;
+        }
+    }
+    if (!tryInitValidStartNode(index)) {
+        setPosition(index, graph.position(agent->currentNodeId));
+        qWarning() << "Vehicle" << id
+                   << "couldn’t find valid path from start, may remain stuck.";
+    }
+    return index;
+}
+
+void VehicleStore::clear()
+{
+    for (int i = 0; i < agents.size(); ++i) {
+        if (flags[i] & WaitingForRoute) {
+            agents[i]->pendingRoute.cancel();
+        }
+    }
+    qDeleteAll(agents);
+    agents.clear();
+    ids.clear();
+    xs.clear();
+    ys.clear();
+    speeds.clear();
+    distances.clear();
+    segmentStarts.clear();
+    segmentEnds.clear();
+    originXs.clear();
+    originYs.clear();
+    stepXs.clear();
+    stepYs.clear();
+    segmentEdges.clear();
+    segments.clear();
+    ranges.clear();
+    messageTimes.clear();
+    odometers.clear();
+    flags.clear();
+    randomStates.clear();
+    obstacleReports.clear();
+}
+
+void VehicleStore::update(double deltaTime)
+{
+    const int count = ids.size();
+    const int chunkCount = qBound(1, count / MIN_CHUNK_SIZE, pool.maxThreadCount());
+
+    // Kinematic phase: chunks run in parallel, this thread takes the first one
+    QVector<QVector<int>> decisions(chunkCount);
+    if (chunkCount > 1) {
+        QSemaphore done;
+        for (int chunk = 1; chunk < chunkCount; ++chunk) {
+            QVector<int> *chunkDecisions = &decisions[chunk];
+            const int first = int(qint64(count) * chunk / chunkCount);
+            const int last = int(qint64(count) * (chunk + 1) / chunkCount);
+            pool.start([this, first, last, deltaTime, chunkDecisions, &done]() {
+                advanceChunk(first, last, deltaTime, *chunkDecisions);
+                done.release();
+            });
+        }
+        advanceChunk(0, count / chunkCount, deltaTime, decisions[0]);
+        done.acquire(chunkCount - 1);
+    } else {
+        advanceChunk(0, count, deltaTime, decisions[0]);
+    }
+
+    // Commit phase: everything that can reach shared state, in vehicle order
+    for (const QVector<int> &chunk : decisions) {
+        for (int index : chunk) {
+            step(index, deltaTime);
+        }
+    }
+}
+
+void VehicleStore::advanceChunk(int first, int last, double deltaTime, QVector<int> &decisions)
+{
+    // Raw pointers: no detach checks in the loop, and each thread only
+    // writes its own range
+    double *distance = distances.data();
+    double *odometer = odometers.data();
+    double *messageTime = messageTimes.data();
+    double *x = xs.data();
+    double *y = ys.data();
+    quint8 *state = flags.data();
+    const double *speed = speeds.constData();
+    const double *segmentStart = segmentStarts.constData();
+    const double *segmentEnd = segmentEnds.constData();
+    const double *originX = originXs.constData();
+    const double *originY = originYs.constData();
+    const double *stepX = stepXs.constData();
+    const double *stepY = stepYs.constData();
+    Edge *const *segmentEdge = segmentEdges.constData();
+
+    for (int i = first; i < last; ++i) {
+        if (state[i] & MessageReceived) {
+            messageTime[i] -= deltaTime;
+            if (messageTime[i] <= 0.0) {
+                state[i] &= ~MessageReceived;
+            }
+        }
+
+        // Common case: still inside an open segment, nothing to decide
+        const Edge *edge = segmentEdge[i];
+        const double next = distance[i] + speed[i] * deltaTime;
+        if (!(state[i] & WaitingForRoute) && edge && !edge->blocked && next < segmentEnd[i]) {
+            odometer[i] += next - distance[i];
+            distance[i] = next;
+            const double along = next - segmentStart[i];
+            x[i] = originX[i] + along * stepX[i];
+            y[i] = originY[i] + along * stepY[i];
+        } else if (edge || (state[i] & WaitingForRoute)) {
+            decisions.append(i);
+        }
+    }
+}
+
+void VehicleStore::step(int index, double deltaTime)
+{
+    Agent &agent = *agents[index];
+
+    // Routes requested on the previous step are collected now, finished or
+    // not, so the outcome never depends on how fast the pool was
+    if (flags[index] & WaitingForRoute) {
+        agent.pendingRoute.waitForFinished();
+        applyPendingRoute(index);
+        if (flags[index] & WaitingForRoute) {
+            return; // No route; a new destination was requested instead
+        }
+    }
+
+    if (!segmentEdges[index]) {
+        return; // No valid path, staying stationary
+    }
+
+    // The segment being driven was blocked under us: back to its start
+    if (segmentEdges[index]->blocked) {
+        stopBeforeObstacle(index, agent.path.edgeStartSegment(segments[index]));
+        return;
+    }
+
+    const double travelDistance = speeds[index] * deltaTime;
+    const double distance = distances[index] + travelDistance;
+
+    // Enter the segments reached this tick; only those can stop the vehicle
+    while (distance >= segmentEnds[index] && segments[index] + 1 < agent.path.segmentCount()) {
+        const int next = segments[index] + 1;
+        const PathSegment &segment = agent.path.segment(next);
+        if (!segment.startsAtNode) {
+            enterSegment(index, next); // Next straight piece of the same road
+            continue;
+        }
+
+        if (flags[index] & ReplanAtNextNode) {
+            // A received obstacle lies on our route: replan from the node just reached
+            flags[index] &= ~ReplanAtNextNode;
+            odometers[index] += segment.cumulativeLength - distances[index];
+            distances[index] = segment.cumulativeLength;
+            enterSegment(index, next);
+            placeOnSegment(index);
+            agent.currentNodeId = agent.path.getSegmentStartNodeId(next);
+            if (!recalculatePath(index, true)) {
+                qWarning() << "Vehicle" << ids[index] << "could not find a new path. Staying stationary.";
+            }
+            return;
+        }
+
+        if (segment.edge->blocked) {
+            stopBeforeObstacle(index, next);
+            return;
+        }
+
+        enterSegment(index, next);
+    }
+
+    // If the vehicle reaches the end of its path, set a new destination
+    if (distance >= agent.path.totalLength()) {
+        odometers[index] += agent.path.totalLength() - distances[index];
+        agent.trips++;
+        const qint64 finalNode = agent.path.getFinalNodeId();
+        if (finalNode >= 0) {
+            agent.currentNodeId = finalNode;
+        }
+        clearPath(index);
+        setPosition(index, graph.position(agent.currentNodeId));
+        setRandomDestination(index);
+        return;
+    }
+
+    odometers[index] += travelDistance;
+    distances[index] = distance;
+    placeOnSegment(index);
+}
+
+void VehicleStore::setPath(int index, const QList<Edge*> &edges)
+{
+    Agent &agent = *agents[index];
+    agent.path = Path(edges, agent.currentNodeId, graph.projection());
+    distances[index] = 0.0;
+    if (agent.path.segmentCount() > 0) {
+        enterSegment(index, 0);
+    } else {
+        segmentEdges[index] = nullptr;
+    }
+    setPosition(index, agent.path.getPositionAtDistance(0.0));
+}
+
+void VehicleStore::clearPath(int index)
+{
+    agents[index]->path = Path();
+    distances[index] = 0.0;
+    segments[index] = 0;
+    segmentStarts[index] = 0.0;
+    segmentEnds[index] = 0.0;
+    segmentEdges[index] = nullptr;
+}
+
+void VehicleStore::enterSegment(int index, int segment)
+{
+    const PathSegment &pathSegment = agents[index]->path.segment(segment);
+    segments[index] = segment;
+    segmentEdges[index] = pathSegment.edge;
+    segmentStarts[index] = pathSegment.cumulativeLength;
+    segmentEnds[index] = pathSegment.cumulativeLength + pathSegment.length;
+
+    // Straight line between the ends of the piece on the local plane
+    const double length = pathSegment.length;
+    originXs[index] = pathSegment.fromX;
+    originYs[index] = pathSegment.fromY;
+    stepXs[index] = length > 0.0 ? (pathSegment.toX - pathSegment.fromX) / length : 0.0;
+    stepYs[index] = length > 0.0 ? (pathSegment.toY - pathSegment.fromY) / length : 0.0;
+}
+
+void VehicleStore::placeOnSegment(int index)
+{
+    const double along = qMin(distances[index], segmentEnds[index]) - segmentStarts[index];
+    xs[index] = originXs[index] + along * stepXs[index];
+    ys[index] = originYs[index] + along * stepYs[index];
+}
+
+void VehicleStore::stopBeforeObstacle(int index, int segment)
+{
+    Agent &agent = *agents[index];
+    const PathSegment &pathSegment = agent.path.segment(segment);
+    qDebug() << "Vehicle" << ids[index] << "encountered a blocked edge. Recalculating path.";
+
+    // Stop at the node before the blocked edge
+    const quint32 blockedEdge = pathSegment.edge->index;
+    odometers[index] += qMax(0.0, pathSegment.cumulativeLength - distances[index]);
+    distances[index] = pathSegment.cumulativeLength;
+    enterSegment(index, segment);
+    agent.currentNodeId = agent.path.getSegmentStartNodeId(segment);
+    setPosition(index, graph.position(agent.currentNodeId));
+
+    // Report the obstacle and attempt to recalculate the path
+    reportObstacle(index, blockedEdge);
+    if (!recalculatePath(index, true)) {
+        qWarning() << "Vehicle" << ids[index] << "could not find a new path. Staying stationary.";
+    }
+}
+
+void VehicleStore::reportObstacle(int index, quint32 edge)
+{
+    Agent &agent = *agents[index];
+    // Mark the edge as blocked for this vehicle, both directions at once
+    if (!agent.knownBlockedEdges.insert(edge)) {
+        return; // Avoid redundant reporting
+    }
+
+    qDebug() << "Vehicle" << ids[index] << "reporting blocked edge:" << edge;
+    obstacleReports.append({index, edge});
+    agent.planner.notifyEdgeChanged(edge);
+}
+
+QVector<VehicleStore::ObstacleReport> VehicleStore::takeObstacleReports()
+{
+    QVector<ObstacleReport> reports;
+    reports.swap(obstacleReports);
+    return reports;
+}
+
+void VehicleStore::receiveObstacle(int index, quint32 edge)
+{
+    Agent &agent = *agents[index];
+    // Mark the edge as blocked
+    if (!agent.knownBlockedEdges.insert(edge)) {
+        return; // Already aware of this blocked edge
+    }
+
+    qDebug() << "Vehicle" << ids[index] << "received blocked edge notification for" << edge;
+    agent.planner.notifyEdgeChanged(edge);
+
+    // Turn the vehicle green for a while
+    setMessageReceived(index, true);
+
+    // Only an obstacle on our own route is worth a replan, at the next node
+    if (pathHasEdge(index, edge)) {
+        flags[index] |= ReplanAtNextNode;
+    }
+}
+
+void VehicleStore::notifyEdgeStateChanged(quint32 edge)
+{
+    for (Agent *agent : agents) {
+        agent->planner.notifyEdgeChanged(edge);
+    }
+}
+
+void VehicleStore::setMessageReceived(int index, bool received)
+{
+    messageTimes[index] = received ? MESSAGE_DURATION : 0.0;
+    if (bool(flags[index] & MessageReceived) != received) {
+        flags[index] ^= MessageReceived;
+        qDebug() << "Vehicle" << ids[index] << "messageReceived set to:" << received;
+    }
+}
+
+void VehicleStore::setPosition(int index, const PlanePoint &position)
+{
+    xs[index] = position.x;
+    ys[index] = position.y;
+}
+
+void VehicleStore::setDestination(int index, qint64 destinationNodeId)
+{
+    Agent &agent = *agents[index];
+    agent.destinationNodeId = destinationNodeId;
+    agent.planner.clear();
+    flags[index] &= ~ReplanAtNextNode;
+    recalculatePath(index);
+}
+
+void VehicleStore::setRandomDestination(int index)
+{
+    const Agent &agent = *agents[index];
+    if (graph.nodeCount() <= 1) {
+        qWarning() << "Vehicle" << ids[index] << "Not enough nodes to pick a random destination. Staying stationary.";
+        return;
+    }
+
+    qint64 newDest = agent.currentNodeId;
+    int maxAttempts = 50;
+    int attempt = 0;
+
+    // Retry finding a valid destination
+    while (attempt < maxAttempts && newDest == agent.currentNodeId) {
+        newDest = graph.nodeIdAt(randomIndex(index, graph.nodeCount()));
+        attempt++;
+    }
+
+    if (newDest == agent.currentNodeId) {
+        qWarning() << "Vehicle" << ids[index] << "could not pick a valid random destination after" << attempt << "attempts.";
+        return;
+    }
+
+    setDestination(index, newDest);
+}
+
+bool VehicleStore::recalculatePath(int index, bool incremental)
+{
+    Agent &agent = *agents[index];
+    if (!graph.hasNode(agent.currentNodeId)) {
+        qWarning() << "Vehicle" << ids[index] << "recalculatePath: currentNodeId" << agent.currentNodeId << "not in graph!";
+        return false;
+    }
+    agent.replans++;
+
+    if (flags[index] & WaitingForRoute) {
+        agent.pendingRoute.cancel(); // Superseded by this request
+        flags[index] &= ~WaitingForRoute;
+    }
+
+    QList<Edge*> pathEdges;
+    bool planned = false;
+    const quint32 destinationIndex = graph.isFrozen() ? graph.csr().indexOf(agent.destinationNodeId) : CsrGraph::InvalidIndex;
+    if (incremental && destinationIndex != CsrGraph::InvalidIndex) {
+        // Same destination, new obstacles: repair the planner's search
+        if (agent.planner.goal() != destinationIndex) {
+            agent.planner.reset(destinationIndex);
+        }
+        planned = agent.planner.replan(graph.csr().indexOf(agent.currentNodeId), pathEdges);
+        if (!planned) {
+            // A failed repair does not prove the destination unreachable:
+            // drop the search state and plan from scratch below
+            agent.planner.clear();
+        }
+    }
+
+    if (!planned && routingService) {
+        // Plan off the GUI thread; the vehicle waits here until it is done
+        agent.pendingRoute = routingService->requestRoute({agent.currentNodeId, agent.destinationNodeId, agent.knownBlockedEdges});
+        flags[index] |= WaitingForRoute;
+        clearPath(index);
+        setPosition(index, graph.position(agent.currentNodeId));
+        return true;
+    }
+    if (!planned) {
+        pathEdges = graph.findPath(agent.currentNodeId, agent.destinationNodeId, agent.knownBlockedEdges);
+    }
+
+    if (pathEdges.isEmpty()) {
+        qWarning() << "Vehicle" << ids[index] << "No path found from" << agent.currentNodeId << "to" << agent.destinationNodeId;
+
+        // Attempt to set a new random destination
+        setRandomDestination(index);
+        if (flags[index] & WaitingForRoute) {
+            return true; // The new destination is being planned
+        }
+
+        // If still no valid path, remain stationary
+        pathEdges = graph.findPath(agent.currentNodeId, agent.destinationNodeId, agent.knownBlockedEdges);
+        if (pathEdges.isEmpty()) {
+            qWarning() << "Vehicle" << ids[index] << "still has no valid path. Staying stationary.";
+            clearPath(index);
+            return false;
+        }
+    }
+
+    setPath(index, pathEdges);
+    return true;
+}
+
+void VehicleStore::applyPendingRoute(int index)
+{
+    Agent &agent = *agents[index];
+    flags[index] &= ~WaitingForRoute;
+    const QList<Edge*> pathEdges = agent.pendingRoute.resultCount() > 0 ? agent.pendingRoute.result() : QList<Edge*>();
+    agent.pendingRoute = QFuture<QList<Edge*>>();
+
+    if (pathEdges.isEmpty()) {
+        qWarning() << "Vehicle" << ids[index] << "No path found from" << agent.currentNodeId << "to" << agent.destinationNodeId;
+        setRandomDestination(index);
+        return;
+    }
+
+    setPath(index, pathEdges);
+
+    // Obstacles learned while the request was in flight
+    for (Edge *edge : pathEdges) {
+        if (agent.knownBlockedEdges.contains(edge->index)) {
+            recalculatePath(index, true);
+            break;
+        }
+    }
+}
+
+bool VehicleStore::tryInitValidStartNode(int index)
+{
+    Agent &agent = *agents[index];
+    for (int attempt = 0; attempt < MAX_START_RETRIES; ++attempt) {
+        qint64 testDest = agent.currentNodeId;
+        while (testDest == agent.currentNodeId && graph.nodeCount() > 1) {
+            testDest = graph.nodeIdAt(
+                randomIndex(index, graph.nodeCount())
+                );
+        }
+
+        QList<Edge*> pathEdges = graph.findPath(agent.currentNodeId, testDest, agent.knownBlockedEdges);
+        if (!pathEdges.isEmpty()) {
+            agent.destinationNodeId = testDest;
+            setPath(index, pathEdges);
+            return true;
+        }
+
+        qWarning() << "Vehicle" << ids[index]
+                   << "No path from" << agent.currentNodeId << "to" << testDest
+                   << "(attempt" << attempt << ") picking new start node.";
+
+        if (graph.nodeCount() > 0) {
+            agent.currentNodeId = graph.nodeIdAt(
+                randomIndex(index, graph.nodeCount())
+                );
+        } else {
+            qWarning() << "Graph has no nodes.";
+            return false;
+        }
+    }
+    return false;
+}
+
+bool VehicleStore::pathHasEdge(int index, quint32 edge) const
+{
+    // Only the part of the route still ahead matters
+    const Path &path = agents[index]->path;
+    for (int i = segments[index]; i < path.segmentCount(); ++i) {
+        if (path.segment(i).edge->index == edge) {
+            return true;
+        }
+    }
+    return false;
+}
+
+double VehicleStore::randomReal(int index, double bound)
+{
+    return double(nextRandom(randomStates[index]) >> 11) * (1.0 / 9007199254740992.0) * bound;
+}
+
+int VehicleStore::randomIndex(int index, int bound)
+{
+    return int((nextRandom(randomStates[index]) >> 32) * quint64(bound) >> 32);
+}
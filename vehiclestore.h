@@ -0,0 +1,195 @@
+// vehiclestore.h
+#ifndef VEHICLESTORE_H
+#define VEHICLESTORE_H
+
+#include <QVector>
+#include <QString>
+#include <QFuture>
+#include <QGeoCoordinate>
+#include <QThreadPool>
+#include "path.h"
+#include "graph.h"
+#include "dstarlite.h"
+
+class RoutingService;
+
+/**
+ * @brief The VehicleStore class
+ * State of every vehicle in the simulation, laid out as parallel arrays.
+ *
+ * What the per-tick update reads (position in meters on the graph's local
+ * plane, speed, distance along the path, current segment with its bounds
+ * and direction, flags) lives in contiguous arrays indexed by vehicle, and
+ * update() walks them in one loop without emitting anything. The current
+ * segment acts as a cursor that only moves forward, so a tick costs the
+ * same whatever the path length. A vehicle only touches its routing state
+ * (path, known obstacles, planner, pending route) when it leaves its
+ * segment, waits for a route or hits an obstacle. Obstacle reports are
+ * queued for the caller to broadcast, and the map's VehicleLayer reads the
+ * positions from here when it repaints.
+ *
+ * update() runs in two phases. The kinematic phase moves vehicles inside
+ * their segment in parallel chunks; it only writes the vehicle's own array
+ * entries. Vehicles that need a decision (next segment, obstacle, arrival,
+ * route to collect) are then handled serially in index order. Every vehicle
+ * draws from its own random stream seeded from the store seed and its id,
+ * and a route requested during a step is collected on the next one, so a
+ * run is the same whatever the thread count.
+ */
+class VehicleStore
+{
+public:
+    enum Flag : quint8 {
+        WaitingForRoute = 0x01,  // A route request is in flight
+        ReplanAtNextNode = 0x02, // A received obstacle lies on the route
+        MessageReceived = 0x04
+    };
+
+    struct ObstacleReport {
+        int vehicle;
+        quint32 edge; // Dense edge id
+    };
+
+    explicit VehicleStore(Graph &graph);
+    ~VehicleStore();
+
+    /**
+     * @brief setSeed
+     * Seeds the random streams of the vehicles added from now on.
+     */
+    void setSeed(quint64 seed) { baseSeed = seed; }
+    quint64 seed() const { return baseSeed; }
+
+    // Threads used by the kinematic phase of update()
+    void setThreadCount(int count) { pool.setMaxThreadCount(qMax(1, count)); }
+    int threadCount() const { return pool.maxThreadCount(); }
+
+    /**
+     * @brief setRoutingService
+     * Plans new destinations on the service's worker pool. A vehicle waits
+     * at its node until the route arrives; obstacle repairs stay synchronous.
+     */
+    void setRoutingService(RoutingService *service) { routingService = service; }
+
+    /**
+     * @brief add
+     * Creates a vehicle at startNodeId (or a random node if it is unknown)
+     * with a random speed and radio, and returns its index.
+     */
+    int add(int id, qint64 startNodeId);
+    void clear();
+    int size() const { return ids.size(); }
+
+    /**
+     * @brief update
+     * Moves every vehicle by deltaTime simulated seconds.
+     */
+    void update(double deltaTime);
+
+    // Obstacles hit during update(), in vehicle order; the caller broadcasts them
+    QVector<ObstacleReport> takeObstacleReports();
+
+    /**
+     * @brief receiveObstacle
+     * V2V notification: vehicle index learns that edge (a dense edge id)
+     * is blocked and replans at its next node if its route uses it.
+     */
+    void receiveObstacle(int index, quint32 edge);
+
+    /**
+     * @brief notifyEdgeStateChanged
+     * Tells every incremental planner that an edge was blocked or unblocked
+     * in the graph.
+     */
+    void notifyEdgeStateChanged(quint32 edge);
+
+    int id(int index) const { return ids[index]; }
+    PlanePoint position(int index) const { return {xs[index], ys[index]}; }
+    const QVector<double> &xData() const { return xs; }
+    const QVector<double> &yData() const { return ys; }
+
+    // Positions are kept on the graph's local plane; lat/lon are for display
+    double latitude(int index) const { return graph.projection().latitude(position(index)); }
+    double longitude(int index) const { return graph.projection().longitude(position(index)); }
+    QGeoCoordinate coordinate(int index) const { return graph.projection().coordinate(position(index)); }
+
+    double communicationRange(int index) const { return ranges[index]; }
+    void setCommunicationRange(int index, double range) { ranges[index] = range; }
+    const QString &color(int index) const { return agents[index]->color; }
+
+    bool messageReceived(int index) const { return flags[index] & MessageReceived; }
+    void setMessageReceived(int index, bool received);
+
+    // Counters for the end-of-run metrics
+    double distanceTravelled(int index) const { return odometers[index]; }
+    int tripsCompleted(int index) const { return agents[index]->trips; }
+    int replanCount(int index) const { return agents[index]->replans; }
+    bool isWaitingForRoute(int index) const { return flags[index] & WaitingForRoute; }
+
+private:
+    // Routing state, only touched off the fast path
+    struct Agent {
+        explicit Agent(const Graph &graph) : planner(graph, &knownBlockedEdges) {}
+
+        qint64 currentNodeId = -1;
+        qint64 destinationNodeId = -1;
+        Path path;
+        EdgeSet knownBlockedEdges;
+        DStarLite planner; // Kept alive across obstacles while the destination is unchanged
+        QFuture<QList<Edge*>> pendingRoute;
+        QString color;
+        int trips = 0;
+        int replans = 0;
+    };
+
+    void advanceChunk(int first, int last, double deltaTime, QVector<int> &decisions);
+    void step(int index, double deltaTime);
+    void setPath(int index, const QList<Edge*> &edges);
+    void clearPath(int index);
+    void enterSegment(int index, int segment);
+    void placeOnSegment(int index);
+    void stopBeforeObstacle(int index, int segment);
+    void reportObstacle(int index, quint32 edge);
+    bool recalculatePath(int index, bool incremental = false);
+    void applyPendingRoute(int index);
+    void setDestination(int index, qint64 destinationNodeId);
+    void setRandomDestination(int index);
+    bool tryInitValidStartNode(int index);
+    bool pathHasEdge(int index, quint32 edge) const;
+    void setPosition(int index, const PlanePoint &position);
+
+    // The vehicle's own random stream
+    double randomReal(int index, double bound);
+    int randomIndex(int index, int bound);
+
+    Graph &graph;
+    RoutingService *routingService = nullptr;
+
+    // Hot state, one entry per vehicle
+    QVector<double> xs;              // Position on the graph's local plane, in meters
+    QVector<double> ys;
+    QVector<double> speeds;          // m/s
+    QVector<double> distances;       // Along the current path
+    QVector<double> segmentStarts;   // Path distance where the current segment starts
+    QVector<double> segmentEnds;     // ... and where it ends
+    QVector<double> originXs;        // Entry point of the current segment
+    QVector<double> originYs;
+    QVector<double> stepXs;          // Direction of the current segment, per meter travelled
+    QVector<double> stepYs;
+    QVector<Edge*> segmentEdges;     // Edge of the current segment, nullptr without a path
+    QVector<int> segments;
+    QVector<double> ranges;          // Communication range in meters
+    QVector<double> messageTimes;    // Simulated seconds before MessageReceived resets
+    QVector<double> odometers;
+    QVector<quint8> flags;
+    QVector<int> ids;
+    QVector<quint64> randomStates;
+
+    QVector<Agent*> agents;
+    QVector<ObstacleReport> obstacleReports;
+
+    quint64 baseSeed;
+    QThreadPool pool;
+};
+
+#endif // VEHICLESTORE_H
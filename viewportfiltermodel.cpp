@@ -0,0 +1,39 @@
+#include "viewportfiltermodel.h"
+
+ViewportFilterModel::ViewportFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent) {}
+
+void ViewportFilterModel::setSourceModel(QAbstractItemModel *sourceModel) {
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+
+    const QHash<int, QByteArray> roles = sourceModel ? sourceModel->roleNames() : QHash<int, QByteArray>();
+    startLatRole = roles.key("startLat", -1);
+    startLonRole = roles.key("startLon", -1);
+    endLatRole = roles.key("endLat", -1);
+    endLonRole = roles.key("endLon", -1);
+    invalidateFilter();
+}
+
+void ViewportFilterModel::setViewport(const QGeoRectangle &region) {
+    if (viewport == region)
+        return;
+    viewport = region;
+    invalidateFilter();
+}
+
+bool ViewportFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const {
+    if (!viewport.isValid() || startLatRole < 0 || startLonRole < 0 || endLatRole < 0 || endLonRole < 0)
+        return true;
+
+    const QModelIndex row = sourceModel()->index(sourceRow, 0, sourceParent);
+    const double startLat = row.data(startLatRole).toDouble();
+    const double startLon = row.data(startLonRole).toDouble();
+    const double endLat = row.data(endLatRole).toDouble();
+    const double endLon = row.data(endLonRole).toDouble();
+
+    // Segments are short next to the viewport, their bounding box is enough
+    return qMin(startLat, endLat) <= viewport.topLeft().latitude()
+        && qMax(startLat, endLat) >= viewport.bottomRight().latitude()
+        && qMin(startLon, endLon) <= viewport.bottomRight().longitude()
+        && qMax(startLon, endLon) >= viewport.topLeft().longitude();
+}
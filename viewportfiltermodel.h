@@ -0,0 +1,33 @@
+#ifndef VIEWPORTFILTERMODEL_H
+#define VIEWPORTFILTERMODEL_H
+
+#include <QSortFilterProxyModel>
+#include <QGeoRectangle>
+
+/**
+ * @brief The ViewportFilterModel class
+ * Keeps the rows of a segment model (startLat, startLon, endLat and endLon
+ * roles) whose bounding box crosses the area shown on the map, so the map
+ * only instantiates what is on screen. An invalid viewport keeps every row.
+ */
+class ViewportFilterModel : public QSortFilterProxyModel {
+    Q_OBJECT
+
+public:
+    explicit ViewportFilterModel(QObject *parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+    void setViewport(const QGeoRectangle &region);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    QGeoRectangle viewport;
+    int startLatRole = -1;
+    int startLonRole = -1;
+    int endLatRole = -1;
+    int endLonRole = -1;
+};
+
+#endif // VIEWPORTFILTERMODEL_H